@@ -0,0 +1,114 @@
+/**
+ * assets.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements asset lookup (runtime directory, built-in assets, configured
+ *              directory) and cascade loading from files or memory.
+ */
+
+#include "assets.hpp"
+#include "config.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+
+#ifdef EMBED_ASSETS
+#include "embedded_assets.inc"
+static const size_t EMBEDDED_ASSET_COUNT = sizeof(EMBEDDED_ASSETS) / sizeof(EMBEDDED_ASSETS[0]);
+#else
+static const Assets::EmbeddedAsset* const EMBEDDED_ASSETS = nullptr;
+static const size_t EMBEDDED_ASSET_COUNT = 0;
+#endif
+
+namespace fs = std::filesystem;
+
+static const std::string EMBEDDED_PREFIX = "embedded:";
+
+static std::mutex directoryMutex;
+static std::string directoryOverride;
+
+namespace Assets {
+
+    void setDirectory(const std::string& dir) {
+        std::lock_guard<std::mutex> lock(directoryMutex);
+        directoryOverride = dir;
+    }
+
+    std::string directory() {
+        {
+            std::lock_guard<std::mutex> lock(directoryMutex);
+            if (!directoryOverride.empty()) return directoryOverride;
+        }
+        const char* env = std::getenv(config::ASSET_DIR_ENV);
+        return env ? std::string(env) : std::string();
+    }
+
+    // Built-in asset with the given file name
+    static const EmbeddedAsset* embeddedByName(const std::string& name) {
+        for (size_t i = 0; i < EMBEDDED_ASSET_COUNT; ++i) {
+            if (name == EMBEDDED_ASSETS[i].name) return &EMBEDDED_ASSETS[i];
+        }
+        return nullptr;
+    }
+
+    std::string resolve(const std::string& relativePath) {
+        const std::string name = fs::path(relativePath).filename().string();
+
+        // An explicit directory wins; deployments may keep the assets in its top level
+        const std::string dir = directory();
+        if (!dir.empty()) {
+            fs::path nested = fs::path(dir) / relativePath;
+            fs::path flat = fs::path(dir) / name;
+            return (!fs::exists(nested) && fs::exists(flat) ? flat : nested).string();
+        }
+        if (embeddedByName(name)) return EMBEDDED_PREFIX + name;
+        return (fs::path(config::ASSET_DIR) / relativePath).string();
+    }
+
+    std::string modelPath() { return resolve(config::MODEL_FILE); }
+    std::string faceCascadePath() { return resolve(config::FACE_CASCADE_FILE); }
+    std::string eyeCascadePath() { return resolve(config::EYE_CASCADE_FILE); }
+
+    const EmbeddedAsset* findEmbedded(const std::string& path) {
+        if (path.compare(0, EMBEDDED_PREFIX.size(), EMBEDDED_PREFIX) != 0) return nullptr;
+        return embeddedByName(path.substr(EMBEDDED_PREFIX.size()));
+    }
+
+    size_t embeddedCount() {
+        return EMBEDDED_ASSET_COUNT;
+    }
+
+    bool loadCascades(const std::string& path, const std::vector<cv::CascadeClassifier*>& cascades) {
+        const EmbeddedAsset* embedded = findEmbedded(path);
+        if (!embedded && path.compare(0, EMBEDDED_PREFIX.size(), EMBEDDED_PREFIX) == 0) return false;
+
+        cv::FileStorage storage;
+        try {
+            if (embedded) {
+                storage.open(std::string(reinterpret_cast<const char*>(embedded->data), embedded->size),
+                             cv::FileStorage::READ | cv::FileStorage::MEMORY);
+            } else {
+                storage.open(path, cv::FileStorage::READ);
+            }
+        } catch (const cv::Exception&) {
+            return false;
+        }
+
+        // Parse once, then build every classifier from the same node
+        if (storage.isOpened()) {
+            const cv::FileNode root = storage.getFirstTopLevelNode();
+            bool loaded = true;
+            for (cv::CascadeClassifier* cascade : cascades) {
+                loaded = loaded && cascade->read(root);
+            }
+            if (loaded) return true;
+        }
+
+        // Old-format cascades are only understood by load()
+        if (embedded) return false;
+        for (cv::CascadeClassifier* cascade : cascades) {
+            if (!cascade->load(path)) return false;
+        }
+        return true;
+    }
+}
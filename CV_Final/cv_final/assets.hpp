@@ -0,0 +1,58 @@
+/**
+ * assets.hpp
+ * Author: Niloofar Karimi
+ * Description: Locates the model and the Haar cascades at runtime.
+ *              Each asset has a path relative to an asset directory (config::MODEL_FILE, ...).
+ *              They are looked up in order: the directory set with setDirectory() (--assets) or
+ *              the EMOTION_ASSETS environment variable, then the assets built into the binary,
+ *              then config::ASSET_DIR. Built-in assets come from embedded_assets.inc, written by
+ *              the embed_assets tool and compiled in with -DEMBED_ASSETS; they are referred to
+ *              as "embedded:<file name>" and loaded straight from memory.
+ */
+
+#pragma once
+#include <opencv2/objdetect.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Assets {
+
+    // An asset compiled into the binary
+    struct EmbeddedAsset {
+        const char* name;              // File name, e.g. "mini_xception.onnx"
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // Directory searched first (empty: $EMOTION_ASSETS, then the built-in assets)
+    void setDirectory(const std::string& dir);
+
+    // Directory in use: setDirectory(), else $EMOTION_ASSETS, else empty
+    std::string directory();
+
+    // Location of the asset at `relativePath` (e.g. config::MODEL_FILE): a file in the asset
+    // directory (or directly in it, without the subfolder), an "embedded:" reference, or the
+    // file under config::ASSET_DIR
+    std::string resolve(const std::string& relativePath);
+
+    // Resolved locations of the model and the cascades
+    std::string modelPath();
+    std::string faceCascadePath();
+    std::string eyeCascadePath();
+
+    // The built-in asset `path` refers to, or nullptr for file paths
+    const EmbeddedAsset* findEmbedded(const std::string& path);
+
+    // Number of assets built into this binary
+    size_t embeddedCount();
+
+    // Load the cascade at `path` (file or embedded) into each of `cascades`. The XML is parsed
+    // once however many copies are needed. Returns false if it cannot be loaded.
+    bool loadCascades(const std::string& path, const std::vector<cv::CascadeClassifier*>& cascades);
+
+    // Same, for a single cascade
+    inline bool loadCascade(const std::string& path, cv::CascadeClassifier& cascade) {
+        return loadCascades(path, {&cascade});
+    }
+}
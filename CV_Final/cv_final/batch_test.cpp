@@ -2,8 +2,25 @@
  * batch_test.cpp
  * Author: Niloofar Karimi
  * Description: Batch evaluation script to test emotion classification on a folder of grayscale images
- *              using ONNX model with test-time augmentation (TTA). Outputs predictions to a CSV
- *              and computes overall accuracy.
+ *              using ONNX model with test-time augmentation (TTA). Images are decoded and classified
+ *              in parallel on a work-stealing pool (one model per worker). Outputs predictions to a
+ *              CSV in sorted order and computes overall accuracy and a per-class confusion matrix.
+ *
+ *              The test set may also be a packed dataset built by the `pack` tool: its faces are
+ *              already decoded, equalized and cropped, so evaluation maps the file and goes straight
+ *              to inference (u8 packs keep TTA; f32 packs hold model-ready tensors and skip it).
+ *
+ *              With --tta-mode adaptive only faces the single pass is unsure about are rerun with
+ *              the TTA variants; single-pass and full-TTA runs are evaluated as well, to report the
+ *              escalation rate and how much of TTA's accuracy gain adaptive TTA keeps.
+ *
+ *              With a reduced precision (--precision fp16/int8) the FP32 model is evaluated first and
+ *              the accuracy delta and throughput gain are reported; the run fails (exit code 2)
+ *              if accuracy drops by more than the tolerance.
+ *
+ * Usage: batch_test <test_dir | test.fpk> [--workers N] [--output results1.csv] [--no-tta] [--tta-mode off|on|adaptive]
+ *                   [--backend opencv|onnxruntime]
+ *                   [--precision fp32|fp16|int8] [--tolerance 1.0] [--no-compare] [--assets <dir>]
  */
 
 #ifdef RUN_BATCH
@@ -13,12 +30,18 @@
 #include <opencv2/imgcodecs.hpp>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <iomanip>
 #include <map>
+#include <memory>
 #include <algorithm>
+#include <chrono>
+#include <future>
 
+#include "assets.hpp"
 #include "config.hpp"
 #include "emotion_classifier.hpp"
+#include "packed_dataset.hpp"
+#include "work_stealing_pool.hpp"
 
 namespace fs = std::filesystem;
 
@@ -44,73 +67,368 @@ std::string normalize_label(const std::string& raw_label) {
     return it != label_map.end() ? it->second : raw_label;
 }
 
-int main() {
+// One evaluated image, stored at its position in the sorted file list
+struct Sample {
+    fs::path path;
+    std::string trueLabel;
+    std::string predicted;
+    bool decoded = false;
+    bool escalated = false;     // Adaptive TTA reran this image with the variants
+};
+
+// Classify one shard with the given TTA mode; `escalated` gets one flag per image
+static void classifyShard(EmotionClassifier& classifier, const std::vector<cv::Mat>& images, TtaMode ttaMode,
+                          std::vector<EmotionPrediction>& predictions, std::vector<uchar>& escalated) {
+    if (ttaMode == TtaMode::Adaptive) {
+        classifier.classifyAdaptive(images, predictions, escalated);
+    } else {
+        classifier.classifyBatch(images, ttaMode == TtaMode::On, predictions);
+        escalated.assign(images.size(), 0);
+    }
+}
+
+// Decode and classify every sample on a work-stealing pool with the given engine settings,
+// filling in Sample::decoded, Sample::predicted and Sample::escalated. With `packed`, sample i is face i of the
+// packed dataset and decoding is skipped. Returns the wall-clock time in seconds spent
+// decoding and classifying (model loading excluded).
+static double classifySamples(std::vector<Sample>& samples, int numWorkers,
+                              InferenceEngineConfig engineConfig, TtaMode ttaMode,
+                              const PackedDataset* packed = nullptr) {
+    // One classifier (and ONNX network) per worker; the inference library's own threading
+    // is disabled because the workers already keep every core busy
+    WorkStealingPool pool(numWorkers);
+    if (pool.size() > 1) {
+        cv::setNumThreads(1);
+        engineConfig.numThreads = 1;
+    }
+    // Models load in parallel and are warmed up, so the timing below covers neither the load
+    // nor the first forward pass's lazy setup
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<std::future<std::unique_ptr<EmotionClassifier>>> loading;
+    for (int i = 0; i < pool.size(); ++i) {
+        loading.push_back(std::async(std::launch::async, [&engineConfig]() {
+            auto classifier = std::make_unique<EmotionClassifier>(Assets::modelPath(), engineConfig);
+            // Images are independent, so adaptive TTA has no per-frame budget here
+            AdaptiveTtaConfig adaptive;
+            adaptive.maxExtraForwards = -1;
+            classifier->setAdaptiveTta(adaptive);
+            if (config::WARMUP_INFERENCE) classifier->warmUp();
+            return classifier;
+        }));
+    }
+    std::vector<std::unique_ptr<EmotionClassifier>> classifiers;
+    for (auto& classifier : loading) {
+        classifiers.push_back(classifier.get());
+    }
+    std::cout << "Startup: " << classifiers.size() << " model(s) loaded"
+              << (config::WARMUP_INFERENCE ? " and warmed up" : "") << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count()
+              << " ms\n";
+    const int batchSize = classifiers.front()->getMaxBatchSize();
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Packed faces are already preprocessed: each shard is a single classification task
+    if (packed) {
+        for (size_t start = 0; start < samples.size(); start += batchSize) {
+            size_t end = std::min(samples.size(), start + static_cast<size_t>(batchSize));
+
+            pool.submit([&, start, end](int workerId) {
+                std::vector<EmotionPrediction> predictions;
+                std::vector<uchar> escalated(end - start, 0);
+                if (packed->format() == PackedFormat::F32) {
+                    classifiers[workerId]->classifyTensors(packed->tensor(start), static_cast<int>(end - start), predictions);
+                } else {
+                    std::vector<cv::Mat> images;
+                    for (size_t i = start; i < end; ++i) images.push_back(packed->image(i));
+                    classifyShard(*classifiers[workerId], images, ttaMode, predictions, escalated);
+                }
+                for (size_t k = 0; k < predictions.size(); ++k) {
+                    samples[start + k].predicted = emotionLabel(predictions[k]);
+                    samples[start + k].escalated = escalated[k] != 0;
+                }
+            });
+        }
+        pool.wait();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Each shard is decoded by one task, which then queues its own classification on the
+    // same worker. Idle workers steal pending decode shards, so decoding of later shards
+    // overlaps with inference on earlier ones.
+    for (size_t start = 0; start < samples.size(); start += batchSize) {
+        size_t end = std::min(samples.size(), start + static_cast<size_t>(batchSize));
+
+        pool.submit([&, start, end](int) {
+            auto images = std::make_shared<std::vector<cv::Mat>>();
+            auto indices = std::make_shared<std::vector<size_t>>();
+
+            for (size_t i = start; i < end; ++i) {
+                cv::Mat img = cv::imread(samples[i].path.string(), cv::IMREAD_GRAYSCALE);
+                if (img.empty()) continue;
+
+                // Improve contrast for better detection
+                cv::equalizeHist(img, img);
+                samples[i].decoded = true;
+                images->push_back(img);
+                indices->push_back(i);
+            }
+
+            pool.submitLocal([&, images, indices](int workerId) {
+                std::vector<EmotionPrediction> predictions;
+                std::vector<uchar> escalated;
+                classifyShard(*classifiers[workerId], *images, ttaMode, predictions, escalated);
+                for (size_t k = 0; k < predictions.size(); ++k) {
+                    samples[(*indices)[k]].predicted = emotionLabel(predictions[k]);
+                    samples[(*indices)[k]].escalated = escalated[k] != 0;
+                }
+            });
+        });
+    }
+    pool.wait();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Percentage of decoded samples whose prediction matches the true label
+static double accuracyOf(const std::vector<Sample>& samples) {
+    int correct = 0, total = 0;
+    for (const auto& sample : samples) {
+        if (!sample.decoded) continue;
+        if (normalize_label(sample.trueLabel) == normalize_label(sample.predicted)) ++correct;
+        ++total;
+    }
+    return total > 0 ? (double)correct / total * 100.0 : 0.0;
+}
+
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <test_dir | test.fpk> [--workers N] [--output results1.csv] [--no-tta] [--tta-mode MODE]"
+              << " [--backend NAME] [--precision NAME] [--tolerance PP] [--no-compare] [--assets DIR]\n"
+              << "  test_dir   folder with one subfolder of images per emotion label\n"
+              << "  test.fpk   packed dataset written by the pack tool (decoding is skipped)\n"
+              << "  --workers  number of parallel workers (default: number of cores)\n"
+              << "  --output   CSV file for per-image predictions (default: results1.csv)\n"
+              << "  --no-tta   classify without test-time augmentation (same as --tta-mode off)\n"
+              << "  --tta-mode off, on (every image, default) or adaptive (only images the single pass is unsure about)\n"
+              << "  --backend  inference engine: opencv or onnxruntime (default: " << config::INFERENCE_BACKEND << ")\n"
+              << "  --precision  fp32, fp16 or int8 (default: " << config::INFERENCE_PRECISION << ")\n"
+              << "  --tolerance  largest accepted accuracy drop versus FP32, in percentage points (default: "
+              << config::PRECISION_ACCURACY_TOLERANCE << ")\n"
+              << "  --no-compare  skip the reference runs: FP32 for reduced precisions, single pass and full TTA\n"
+              << "                for adaptive TTA\n"
+              << "  --assets   directory with the model (default: $" << config::ASSET_DIR_ENV << ", built-in assets, or "
+              << config::ASSET_DIR << ")\n";
+}
+
+int main(int argc, char** argv) {
     try {
-        // Initialize classifier with ONNX model path
-        EmotionClassifier classifier(config::MODEL_PATH);
+        // Parse command-line options
+        std::string testDir;
+        std::string outputPath = "results1.csv";
+        int numWorkers = 0;
+        TtaMode ttaMode = TtaMode::On;
+        InferenceEngineConfig engineConfig;
+        double tolerance = config::PRECISION_ACCURACY_TOLERANCE;
+        bool compareToFP32 = true;
 
-        std::ofstream log("results1.csv");
-        log << "Image,TrueLabel,Predicted\n";
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--workers" && i + 1 < argc) {
+                numWorkers = std::stoi(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "--no-tta") {
+                ttaMode = TtaMode::Off;
+            } else if (arg == "--tta-mode" && i + 1 < argc) {
+                ttaMode = parseTtaMode(argv[++i]);
+            } else if (arg == "--backend" && i + 1 < argc) {
+                engineConfig.backend = parseInferenceBackend(argv[++i]);
+            } else if (arg == "--precision" && i + 1 < argc) {
+                engineConfig.precision = parseInferencePrecision(argv[++i]);
+            } else if (arg == "--tolerance" && i + 1 < argc) {
+                tolerance = std::stod(argv[++i]);
+            } else if (arg == "--no-compare") {
+                compareToFP32 = false;
+            } else if (arg == "--assets" && i + 1 < argc) {
+                Assets::setDirectory(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (testDir.empty() && arg.rfind("--", 0) != 0) {
+                testDir = arg;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
 
         // Directory with test images (subfolders as class labels)
-        std::string testDir = "/Users/niloofarkarimi/CV_Final/test_images";
+        if (testDir.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
         if (!fs::exists(testDir)) {
             std::cerr << "Directory '" << testDir << "' does not exist.\n";
             return 1;
         }
 
-        // Loop through all images recursively in test folder
-        for (const auto& entry : fs::recursive_directory_iterator(testDir)) {
-            if (!entry.is_regular_file()) continue;
+        std::vector<Sample> samples;
+        std::unique_ptr<PackedDataset> packed;
+        if (fs::is_regular_file(testDir) && PackedDataset::isPackedDataset(testDir)) {
+            // Packed dataset: samples come from the file, already in sorted order
+            packed = std::make_unique<PackedDataset>(testDir);
+            if (packed->imageSize() != cv::Size(config::INPUT_WIDTH, config::INPUT_HEIGHT)) {
+                throw std::runtime_error("Packed faces are " + std::to_string(packed->imageSize().width) + "x" +
+                                         std::to_string(packed->imageSize().height) + ", the model expects " +
+                                         std::to_string(config::INPUT_WIDTH) + "x" + std::to_string(config::INPUT_HEIGHT));
+            }
+            if (ttaMode != TtaMode::Off && packed->format() == PackedFormat::F32) {
+                std::cout << "Note: f32 packs hold model-ready tensors; evaluating without TTA\n";
+                ttaMode = TtaMode::Off;
+            }
+            for (size_t i = 0; i < packed->size(); ++i) {
+                Sample sample;
+                sample.path = packed->name(i);
+                int label = packed->label(i);
+                sample.trueLabel = label >= 0 ? normalize_label(packed->labelName(label)) : "";
+                sample.decoded = true;
+                samples.push_back(std::move(sample));
+            }
+        } else {
+            // Collect all images recursively and sort them so the output order is deterministic
+            for (const auto& entry : fs::recursive_directory_iterator(testDir)) {
+                if (!entry.is_regular_file()) continue;
+                Sample sample;
+                sample.path = entry.path();
+                sample.trueLabel = normalize_label(entry.path().parent_path().filename().string());
+                samples.push_back(std::move(sample));
+            }
+            std::sort(samples.begin(), samples.end(),
+                      [](const Sample& a, const Sample& b) { return a.path < b.path; });
+        }
+
+        // Reduced precision: evaluate the FP32 model first as the accuracy and speed reference
+        const bool comparePrecision = compareToFP32 && engineConfig.precision != InferencePrecision::FP32;
+        double referenceAccuracy = 0.0, referenceSeconds = 0.0;
+        if (comparePrecision) {
+            InferenceEngineConfig referenceConfig = engineConfig;
+            referenceConfig.precision = InferencePrecision::FP32;
+            referenceSeconds = classifySamples(samples, numWorkers, referenceConfig, ttaMode, packed.get());
+            referenceAccuracy = accuracyOf(samples);
+        }
+
+        // Adaptive TTA: single pass and full TTA are the cost and accuracy bounds it sits between
+        const bool compareTta = compareToFP32 && ttaMode == TtaMode::Adaptive;
+        double singleAccuracy = 0.0, singleSeconds = 0.0, fullAccuracy = 0.0, fullSeconds = 0.0;
+        if (compareTta) {
+            singleSeconds = classifySamples(samples, numWorkers, engineConfig, TtaMode::Off, packed.get());
+            singleAccuracy = accuracyOf(samples);
+            fullSeconds = classifySamples(samples, numWorkers, engineConfig, TtaMode::On, packed.get());
+            fullAccuracy = accuracyOf(samples);
+        }
+
+        double seconds = classifySamples(samples, numWorkers, engineConfig, ttaMode, packed.get());
+
+        // Class order for the confusion matrix: model labels plus an "Uncertain" prediction column
+        std::vector<std::string> classNames;
+        for (const auto& label : config::EMOTION_LABELS) {
+            classNames.push_back(normalize_label(label));
+        }
+        const int numClasses = static_cast<int>(classNames.size());
+        auto classIndex = [&](const std::string& label) {
+            auto it = std::find(classNames.begin(), classNames.end(), normalize_label(label));
+            return it != classNames.end() ? static_cast<int>(it - classNames.begin()) : -1;
+        };
+        std::vector<std::vector<int>> confusion(numClasses, std::vector<int>(numClasses + 1, 0));
+
+        // Log predictions to CSV (in sorted order) and accumulate accuracy in memory
+        std::ofstream log(outputPath);
+        log << "Image,TrueLabel,Predicted\n";
+        int correct = 0, total = 0;
 
-            std::string filepath = entry.path().string();
-            cv::Mat img = cv::imread(filepath, cv::IMREAD_GRAYSCALE);
-            if (img.empty()) {
-                std::cerr << "Failed to read image: " << filepath << std::endl;
+        for (const auto& sample : samples) {
+            if (!sample.decoded) {
+                std::cerr << "Failed to read image: " << sample.path.string() << std::endl;
                 continue;
             }
 
-            // Improve contrast for better detection
-            cv::equalizeHist(img, img);
+            log << sample.path.filename().string() << "," << sample.trueLabel << "," << sample.predicted << "\n";
+            std::cout << sample.path.filename().string()
+                      << " | True: " << sample.trueLabel
+                      << " | Predicted: " << sample.predicted << std::endl;
 
-            // Predict label using test-time augmentation
-            std::string predicted_label = classifier.classifyWithTTA(img);
-            std::string true_label = normalize_label(entry.path().parent_path().filename().string());
+            if (normalize_label(sample.trueLabel) == normalize_label(sample.predicted))
+                ++correct;
+            ++total;
 
-            // Log predictions to CSV and print to console
-            log << entry.path().filename().string() << "," << true_label << "," << predicted_label << "\n";
-            std::cout << entry.path().filename().string()
-                      << " | True: " << true_label
-                      << " | Predicted: " << predicted_label << std::endl;
+            int row = classIndex(sample.trueLabel);
+            if (row >= 0) {
+                int col = classIndex(sample.predicted);
+                ++confusion[row][col >= 0 ? col : numClasses];
+            }
         }
 
         log.close();
-        std::cout << "Results written to results1.csv\n";
+        std::cout << "Results written to " << outputPath << "\n";
 
         // =============================
-        // Compute overall classification accuracy
+        // Overall classification accuracy and per-class confusion matrix
         // =============================
-        std::ifstream infile("results1.csv");
-        std::string line;
-        int correct = 0, total = 0;
-        std::getline(infile, line); // Skip header
+        double accuracy = total > 0 ? (double)correct / total * 100.0 : 0.0;
+        std::cout << "Accuracy: " << accuracy << "% (" << correct << "/" << total << " correct predictions)\n";
 
-        while (std::getline(infile, line)) {
-            std::istringstream ss(line);
-            std::string image, true_label, predicted_label;
+        std::cout << "\nConfusion matrix (rows: true label, columns: predicted label)\n";
+        std::cout << std::setw(11) << "";
+        for (const auto& name : classNames) std::cout << std::setw(11) << name;
+        std::cout << std::setw(11) << "Uncertain" << std::setw(10) << "Recall" << "\n";
 
-            std::getline(ss, image, ',');
-            std::getline(ss, true_label, ',');
-            std::getline(ss, predicted_label, ',');
+        for (int r = 0; r < numClasses; ++r) {
+            int rowTotal = 0;
+            std::cout << std::setw(11) << classNames[r];
+            for (int c = 0; c <= numClasses; ++c) {
+                std::cout << std::setw(11) << confusion[r][c];
+                rowTotal += confusion[r][c];
+            }
+            double recall = rowTotal > 0 ? 100.0 * confusion[r][r] / rowTotal : 0.0;
+            std::cout << std::setw(9) << std::fixed << std::setprecision(1) << recall << "%\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
 
-            if (normalize_label(true_label) == normalize_label(predicted_label))
-                ++correct;
-            ++total;
+        // Adaptive TTA: how often it escalated and how much of TTA's gain it kept
+        if (ttaMode == TtaMode::Adaptive) {
+            size_t escalated = std::count_if(samples.begin(), samples.end(),
+                                             [](const Sample& sample) { return sample.decoded && sample.escalated; });
+            std::cout << "\nAdaptive TTA: escalated " << escalated << " of " << total << " images ("
+                      << (total > 0 ? 100.0 * escalated / total : 0.0) << "%)\n";
+            if (compareTta) {
+                double fullGain = fullAccuracy - singleAccuracy;
+                std::cout << "Single pass: accuracy " << singleAccuracy << "%, "
+                          << (singleSeconds > 0.0 ? total / singleSeconds : 0.0) << " images/s\n"
+                          << "Full TTA:    accuracy " << fullAccuracy << "%, "
+                          << (fullSeconds > 0.0 ? total / fullSeconds : 0.0) << " images/s\n"
+                          << "Accuracy gained over single pass: " << accuracy - singleAccuracy << " points"
+                          << " (full TTA: " << fullGain << " points";
+                if (fullGain > 0.0) std::cout << ", " << 100.0 * (accuracy - singleAccuracy) / fullGain << "% kept";
+                std::cout << ")\n";
+            }
         }
 
-        infile.close();
-        double accuracy = total > 0 ? (double)correct / total * 100.0 : 0.0;
-        std::cout << "Accuracy: " << accuracy << "% (" << correct << "/" << total << " correct predictions)\n";
+        // Throughput, and for reduced precision the comparison with FP32 and the accuracy gate
+        std::cout << "\nThroughput (" << precisionName(engineConfig.precision) << "): "
+                  << (seconds > 0.0 ? total / seconds : 0.0) << " images/s\n";
+        if (comparePrecision) {
+            double delta = accuracy - referenceAccuracy;
+            double speedup = seconds > 0.0 ? referenceSeconds / seconds : 0.0;
+            std::cout << "FP32 reference: accuracy " << referenceAccuracy << "%, "
+                      << (referenceSeconds > 0.0 ? total / referenceSeconds : 0.0) << " images/s\n"
+                      << "Accuracy delta vs FP32: " << delta << " points, throughput gain: " << speedup << "x\n";
+            if (-delta > tolerance) {
+                std::cerr << "Accuracy gate FAILED: " << precisionName(engineConfig.precision)
+                          << " loses " << -delta << " points (tolerance " << tolerance << ")\n";
+                return 2;
+            }
+            std::cout << "Accuracy gate passed (tolerance " << tolerance << " points)\n";
+        }
 
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
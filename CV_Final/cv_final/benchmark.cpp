@@ -0,0 +1,664 @@
+/**
+ * benchmark.cpp
+ * Author: Niloofar Karimi
+ * Description: Headless microbenchmark suite for every stage of the emotion recognition
+ *              pipeline (grayscale conversion, detection, tracking, alignment, preprocessing,
+ *              classification with and without TTA, batched classification and overlay
+ *              drawing), plus a side-by-side comparison of the available inference engines
+ *              (OpenCV DNN, ONNX Runtime) and precisions (FP32, FP16, INT8) on the emotion
+ *              model. Runs on synthetic frames and, optionally, on recorded video frames
+ *              and face crops. Reports latency percentiles and throughput, writes JSON, and
+ *              can compare against a stored baseline to flag regressions.
+ *              Built with ENABLE_PROFILING it also runs a real Pipeline with the realtime
+ *              sink and counts the heap allocations of every stage per frame once warmed up;
+ *              with --check-allocs it fails if anything but Haar detection, eye estimation
+ *              and the classifier's forward pass allocates.
+ *
+ * Usage: benchmark [--quick] [--json out.json] [--baseline base.json] [--tolerance 10]
+ *                  [--video recording.mp4] [--face face.png] [--backend opencv|onnxruntime]
+ *                  [--check-allocs]
+ */
+
+#ifdef RUN_BENCHMARK
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "assets.hpp"
+#include "config.hpp"
+#include "emotion_classifier.hpp"
+#include "emotion_smoother.hpp"
+#include "face_aligner.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "inference_engine.hpp"
+#include "pipeline.hpp"
+#include "preprocess.hpp"
+#include "profiler.hpp"
+#include "result_cache.hpp"
+#include "result_logger.hpp"
+#include "utils.hpp"
+#include "video_overlay.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef ENABLE_PROFILING
+
+// Heap allocations per thread, read by the profiler to attribute them to stages. Every
+// cv::Mat buffer also allocates its UMatData with operator new, so matrix allocations are
+// counted as well. Slots outlive their threads; past MAX_COUNTED_THREADS threads share them.
+static const int MAX_COUNTED_THREADS = 1024;
+static std::atomic<uint64_t> allocationSlots[MAX_COUNTED_THREADS];
+static std::atomic<int> nextAllocationSlot{0};
+
+static std::atomic<uint64_t>* threadAllocations() {
+    thread_local std::atomic<uint64_t>* slot =
+        &allocationSlots[nextAllocationSlot.fetch_add(1) % MAX_COUNTED_THREADS];
+    return slot;
+}
+
+void* operator new(std::size_t size) {
+    std::atomic<uint64_t>* count = threadAllocations();
+    count->store(count->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size > 0 ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif // ENABLE_PROFILING
+
+// Timing results of one benchmark case
+struct BenchResult {
+    std::string id;            // Stage name plus parameters, e.g. "detect/1920x1080/faces=4"
+    int iterations = 0;
+    int itemsPerIteration = 1; // Faces / images processed per timed call
+    double meanMs = 0, p50Ms = 0, p95Ms = 0, p99Ms = 0, maxMs = 0;
+    double throughput = 0;     // Items per second
+};
+
+// Benchmark settings
+struct BenchOptions {
+    double minSeconds = 1.0;   // Minimum measuring time per case
+    int minIterations = 20;
+    int warmupIterations = 3;
+};
+
+// Nearest-rank percentile of an ascending sample list
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    idx = std::min(sorted.size() - 1, idx > 0 ? idx - 1 : 0);
+    return sorted[idx];
+}
+
+// Run `fn` repeatedly and collect per-call latencies
+template <typename Fn>
+static BenchResult runBench(const std::string& id, int items, const BenchOptions& opts, Fn fn) {
+    for (int i = 0; i < opts.warmupIterations; ++i) fn();
+
+    std::vector<double> samples;
+    auto start = Clock::now();
+    while (static_cast<int>(samples.size()) < opts.minIterations ||
+           std::chrono::duration<double>(Clock::now() - start).count() < opts.minSeconds) {
+        auto t0 = Clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    BenchResult r;
+    r.id = id;
+    r.iterations = static_cast<int>(samples.size());
+    r.itemsPerIteration = items;
+    double total = 0;
+    for (double s : samples) total += s;
+    r.meanMs = total / samples.size();
+    r.p50Ms = percentile(samples, 50);
+    r.p95Ms = percentile(samples, 95);
+    r.p99Ms = percentile(samples, 99);
+    r.maxMs = samples.back();
+    r.throughput = r.meanMs > 0 ? items * 1000.0 / r.meanMs : 0.0;
+    return r;
+}
+
+// Draw a simple cartoon face (head, eyes, mouth) into `img` at `box`
+static void drawSyntheticFace(cv::Mat& img, const cv::Rect& box, cv::RNG& rng) {
+    cv::Point center(box.x + box.width / 2, box.y + box.height / 2);
+    int skin = rng.uniform(150, 210);
+    cv::ellipse(img, center, cv::Size(box.width * 2 / 5, box.height / 2), 0, 0, 360, cv::Scalar::all(skin), cv::FILLED);
+    int eyeY = box.y + box.height * 2 / 5;
+    int eyeR = std::max(2, box.width / 14);
+    cv::circle(img, cv::Point(box.x + box.width / 3, eyeY), eyeR, cv::Scalar::all(40), cv::FILLED);
+    cv::circle(img, cv::Point(box.x + box.width * 2 / 3, eyeY), eyeR, cv::Scalar::all(40), cv::FILLED);
+    cv::ellipse(img, cv::Point(center.x, box.y + box.height * 7 / 10), cv::Size(box.width / 6, box.height / 14),
+                0, 0, 180, cv::Scalar::all(60), 2);
+}
+
+// Synthetic BGR frame with `numFaces` faces laid out on a grid over a noisy background.
+// When `face` is non-empty it is pasted instead of the cartoon face.
+static cv::Mat makeFrame(cv::Size size, int numFaces, const cv::Mat& face, std::vector<cv::Rect>& boxes) {
+    cv::RNG rng(12345);
+    cv::Mat gray(size, CV_8UC1);
+    rng.fill(gray, cv::RNG::UNIFORM, cv::Scalar::all(60), cv::Scalar::all(120));
+
+    boxes.clear();
+    int cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numFaces)))));
+    int rows = numFaces > 0 ? (numFaces + cols - 1) / cols : 1;
+    int cell = std::min(size.width / cols, size.height / rows);
+    int faceSize = std::max(40, cell * 3 / 4);
+    for (int i = 0; i < numFaces; ++i) {
+        cv::Rect box((i % cols) * cell + (cell - faceSize) / 2, (i / cols) * cell + (cell - faceSize) / 2,
+                     faceSize, faceSize);
+        box &= cv::Rect(0, 0, size.width, size.height);
+        if (face.empty()) {
+            drawSyntheticFace(gray, box, rng);
+        } else {
+            cv::resize(face, gray(box), box.size());
+        }
+        boxes.push_back(box);
+    }
+
+    cv::Mat bgr;
+    cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+    return bgr;
+}
+
+static void writeJson(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    out << "{\n  \"opencv\": \"" << CV_VERSION << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << std::fixed << std::setprecision(4)
+            << "    {\"id\": \"" << r.id << "\", \"iterations\": " << r.iterations
+            << ", \"items_per_iteration\": " << r.itemsPerIteration
+            << ", \"mean_ms\": " << r.meanMs << ", \"p50_ms\": " << r.p50Ms
+            << ", \"p95_ms\": " << r.p95Ms << ", \"p99_ms\": " << r.p99Ms
+            << ", \"max_ms\": " << r.maxMs << ", \"throughput_per_s\": " << r.throughput << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Read the "id" -> "p50_ms" pairs from a JSON file written by writeJson()
+static std::map<std::string, double> readBaseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open baseline: " + path);
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    std::map<std::string, double> baseline;
+    std::regex entry("\"id\":\\s*\"([^\"]+)\"[^}]*\"p50_ms\":\\s*([0-9.eE+-]+)");
+    for (auto it = std::sregex_iterator(text.begin(), text.end(), entry); it != std::sregex_iterator(); ++it) {
+        baseline[(*it)[1].str()] = std::stod((*it)[2].str());
+    }
+    return baseline;
+}
+
+static void printResult(const BenchResult& r) {
+    std::cout << std::left << std::setw(44) << r.id << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << r.p50Ms << std::setw(10) << r.p95Ms << std::setw(10) << r.p99Ms
+              << std::setw(10) << r.maxMs << std::setprecision(1) << std::setw(12) << r.throughput
+              << std::setw(8) << r.iterations << "\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--quick] [--json out.json] [--baseline base.json]"
+              << " [--tolerance percent] [--video file] [--face image] [--backend NAME] [--check-allocs]\n";
+}
+
+// Allocation count of one stage on one pipeline thread
+struct AllocationStage {
+    std::string name;
+    bool mustBeZero;           // Runs out of reused buffers; anything else is OpenCV-internal
+    uint64_t allocations = 0;
+};
+
+int main(int argc, char** argv) {
+    try {
+        BenchOptions opts;
+        std::string jsonPath = "benchmark.json";
+        std::string baselinePath;
+        std::string videoPath;
+        std::string facePath;
+        double tolerance = 10.0;
+        bool checkAllocations = false;
+        InferenceEngineConfig engineConfig;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--quick") {
+                opts.minSeconds = 0.2;
+                opts.minIterations = 5;
+            } else if (arg == "--json" && i + 1 < argc) {
+                jsonPath = argv[++i];
+            } else if (arg == "--baseline" && i + 1 < argc) {
+                baselinePath = argv[++i];
+            } else if (arg == "--tolerance" && i + 1 < argc) {
+                tolerance = std::stod(argv[++i]);
+            } else if (arg == "--video" && i + 1 < argc) {
+                videoPath = argv[++i];
+            } else if (arg == "--face" && i + 1 < argc) {
+                facePath = argv[++i];
+            } else if (arg == "--backend" && i + 1 < argc) {
+                engineConfig.backend = parseInferenceBackend(argv[++i]);
+            } else if (arg == "--check-allocs") {
+                checkAllocations = true;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+#ifdef ENABLE_PROFILING
+        Profiler::countAllocations([]() -> const std::atomic<uint64_t>* { return threadAllocations(); });
+#else
+        if (checkAllocations) {
+            std::cerr << "--check-allocs needs a build with -DENABLE_PROFILING\n";
+            return 1;
+        }
+#endif
+
+        EmotionClassifier classifier(Assets::modelPath(), engineConfig);
+        classifier.setQuiet(true);
+        FaceDetector detector(Assets::faceCascadePath());
+
+        // Reference detector: full resolution, full size range, single pass
+        FaceDetectorConfig fullResConfig;
+        fullResConfig.maxDetectWidth = 0;
+        fullResConfig.adaptiveSizes = false;
+        fullResConfig.tileRows = fullResConfig.tileCols = 1;
+        FaceDetector fullResDetector(Assets::faceCascadePath(), fullResConfig);
+
+        FaceAligner aligner(Assets::eyeCascadePath());
+
+        // Face crop used by the per-face stages: a recorded face or a synthetic one
+        cv::Mat faceCrop;
+        if (!facePath.empty()) {
+            faceCrop = cv::imread(facePath, cv::IMREAD_GRAYSCALE);
+            if (faceCrop.empty()) {
+                throw std::runtime_error("Failed to read face image: " + facePath);
+            }
+        } else {
+            std::vector<cv::Rect> boxes;
+            cv::Mat frame = makeFrame(cv::Size(160, 160), 1, cv::Mat(), boxes);
+            faceCrop = Utils::toGrayscale(frame)(boxes[0]).clone();
+        }
+
+        std::cout << std::left << std::setw(44) << "benchmark" << std::right
+                  << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(10) << "p99 ms"
+                  << std::setw(10) << "max ms" << std::setw(12) << "items/s" << std::setw(8) << "iters" << "\n";
+
+        std::vector<BenchResult> results;
+        auto record = [&](const BenchResult& r) {
+            printResult(r);
+            results.push_back(r);
+        };
+
+        // ---- Per-face stages ----
+        PreprocessScratch scratch;
+        std::vector<float> tensor(static_cast<size_t>(config::INPUT_WIDTH) * config::INPUT_HEIGHT);
+        cv::Size inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT);
+        record(runBench("preprocess", 1, opts, [&]() {
+            preprocessInto(faceCrop, inputSize, tensor.data(), scratch);
+        }));
+        const cv::Rect cropBox(0, 0, faceCrop.cols, faceCrop.rows);
+        const std::vector<cv::Rect> cropBoxes{cropBox};
+        const std::vector<int> cropTrackIds{0};
+        record(runBench("align/estimate", 1, opts, [&]() {
+            double angle = 0.0;
+            aligner.estimateAngle(faceCrop, cropBox, angle);
+        }));
+        std::vector<double> angles;
+        record(runBench("align/tracked", 1, opts, [&]() {
+            aligner.estimateAngles(faceCrop, cropBoxes, cropTrackIds, angles);
+        }));
+        cv::Mat alignedCrop;
+        record(runBench("align/crop", 1, opts, [&]() {
+            alignCrop(faceCrop, cropBox, 10.0, inputSize, alignedCrop);
+        }));
+        // What a result-cache hit costs instead of a forward pass
+        ResultCache resultCache;
+        ResultCache::Signature signature;
+        ResultCache::computeSignature(alignedCrop, signature);
+        EmotionPrediction cached;
+        resultCache.store(0, 0, signature, cached);
+        record(runBench("resultCache/hit", 1, opts, [&]() {
+            ResultCache::computeSignature(alignedCrop, signature);
+            resultCache.lookup(0, 1, signature, cached);
+        }));
+        record(runBench("classify", 1, opts, [&]() {
+            float confidence;
+            classifier.classify(faceCrop, &confidence);
+        }));
+        record(runBench("classifyWithTTA", 1, opts, [&]() {
+            float confidence;
+            classifier.classifyWithTTA(faceCrop, &confidence);
+        }));
+        for (int batch : {1, 4, 8, 16, 32}) {
+            std::vector<cv::Mat> faces(batch, faceCrop);
+            record(runBench("classifyBatch/batch=" + std::to_string(batch), batch, opts, [&]() {
+                classifier.classifyBatch(faces, false);
+            }));
+            record(runBench("classifyBatch/tta/batch=" + std::to_string(batch), batch, opts, [&]() {
+                classifier.classifyBatch(faces, true);
+            }));
+            // Cost depends on how many faces fall below the adaptive thresholds
+            std::vector<EmotionPrediction> predictions;
+            std::vector<uchar> escalated;
+            record(runBench("classifyBatch/adaptive/batch=" + std::to_string(batch), batch, opts, [&]() {
+                classifier.classifyAdaptive(faces, predictions, escalated);
+            }));
+        }
+
+        // ---- Inference engines: the bare forward pass on identical input tensors ----
+        const int maxEngineBatch = 32;
+        int blobShape[] = {maxEngineBatch, inputSize.height, inputSize.width, 1};
+        cv::Mat engineBlob(4, blobShape, CV_32F);
+        for (int i = 0; i < maxEngineBatch; ++i) {
+            preprocessInto(faceCrop, inputSize, batchSlot(engineBlob, i), scratch);
+        }
+        for (InferenceBackend backend : {InferenceBackend::OpenCvDnn, InferenceBackend::OnnxRuntime}) {
+            if (!isBackendAvailable(backend)) continue;
+            for (InferencePrecision precision : {InferencePrecision::FP32, InferencePrecision::FP16, InferencePrecision::INT8}) {
+                InferenceEngineConfig cfg = engineConfig;
+                cfg.backend = backend;
+                cfg.precision = precision;
+
+                // Not every backend supports every precision (or has an INT8 model/calibration set)
+                std::unique_ptr<InferenceEngine> engine;
+                try {
+                    engine = createInferenceEngine(Assets::modelPath(), cfg);
+                } catch (const std::exception& e) {
+                    std::cerr << "Skipping " << precisionName(precision) << " engine: " << e.what() << "\n";
+                    continue;
+                }
+
+                for (int batch : {1, 8, maxEngineBatch}) {
+                    int shape[] = {batch, inputSize.height, inputSize.width, 1};
+                    cv::Mat blob(4, shape, CV_32F, engineBlob.data);
+                    record(runBench("engine/" + engine->name() + "/batch=" + std::to_string(batch), batch, opts, [&]() {
+                        engine->infer(blob);
+                    }));
+                }
+            }
+        }
+
+        // ---- Per-frame stages on synthetic frames ----
+        cv::Mat pasteFace = facePath.empty() ? cv::Mat() : faceCrop;
+        for (cv::Size size : {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080)}) {
+            std::string res = std::to_string(size.width) + "x" + std::to_string(size.height);
+            for (int numFaces : {0, 1, 4, 10}) {
+                std::vector<cv::Rect> boxes;
+                cv::Mat frame = makeFrame(size, numFaces, pasteFace, boxes);
+                cv::Mat gray = Utils::toGrayscale(frame);
+                std::string suffix = "/" + res + "/faces=" + std::to_string(numFaces);
+
+                if (numFaces == 0) {
+                    record(runBench("toGrayscale/" + res, 1, opts, [&]() { Utils::toGrayscale(frame); }));
+                }
+                record(runBench("detect" + suffix, 1, opts, [&]() { detector.detect(gray); }));
+                record(runBench("detect/fullres" + suffix, 1, opts, [&]() { fullResDetector.detect(gray); }));
+                // The tracker keeps state across calls, so this measures its steady-state mix
+                // of keyframes and tracked frames on a static scene
+                FaceTracker tracker(detector);
+                record(runBench("tracker" + suffix, 1, opts, [&]() { tracker.update(gray); }));
+
+                std::vector<std::string> labels(boxes.size(), "Neutral");
+                std::vector<float> confidences(boxes.size(), 0.5f);
+                cv::Mat canvas = frame.clone();
+                record(runBench("drawDetections" + suffix, 1, opts, [&]() {
+                    VideoOverlay::drawDetections(canvas, boxes, labels, confidences);
+                }));
+            }
+        }
+
+        // ---- Recorded frames ----
+        if (!videoPath.empty()) {
+            cv::VideoCapture cap(videoPath);
+            if (!cap.isOpened()) {
+                throw std::runtime_error("Failed to open video: " + videoPath);
+            }
+            std::vector<cv::Mat> frames;
+            cv::Mat frame;
+            while (frames.size() < 100 && cap.read(frame)) frames.push_back(frame.clone());
+            if (frames.empty()) {
+                throw std::runtime_error("No frames read from video: " + videoPath);
+            }
+
+            size_t next = 0;
+            record(runBench("recorded/toGrayscale", 1, opts, [&]() {
+                Utils::toGrayscale(frames[next++ % frames.size()]);
+            }));
+            std::vector<cv::Mat> grays;
+            for (const auto& f : frames) grays.push_back(Utils::toGrayscale(f));
+            next = 0;
+            record(runBench("recorded/detect", 1, opts, [&]() {
+                detector.detect(grays[next++ % grays.size()]);
+            }));
+            FaceTracker tracker(detector);
+            next = 0;
+            record(runBench("recorded/tracker", 1, opts, [&]() {
+                tracker.update(grays[next++ % grays.size()]);
+            }));
+            next = 0;
+            record(runBench("recorded/frame", 1, opts, [&]() {
+                const cv::Mat& gray = grays[next++ % grays.size()];
+                std::vector<cv::Rect> faces = detector.detect(gray);
+                aligner.estimateAngles(gray, faces, std::vector<int>(faces.size(), -1), angles);
+                std::vector<cv::Mat> aligned(faces.size());
+                for (size_t i = 0; i < faces.size(); ++i) alignCrop(gray, faces[i], angles[i], inputSize, aligned[i]);
+                classifier.classifyBatch(aligned, false);
+            }));
+        }
+
+        // ---- Steady-state allocations per frame ----
+        // A real pipeline (one classify worker, every frame processed, result cache off so every
+        // face reaches the classifier) feeds the realtime sink: logging, smoothing, label
+        // buffers and overlay. The profiler's stage scopes split each thread's allocations.
+        // Parallel loops allocate their job objects when multi-threaded, so OpenCV runs
+        // single-threaded meanwhile.
+        int allocationFailures = 0;
+#ifdef ENABLE_PROFILING
+        {
+            const int previousThreads = cv::getNumThreads();
+            cv::setNumThreads(1);
+
+            std::vector<cv::Mat> allocFrames;
+            for (int numFaces : {1, 4}) {
+                std::vector<cv::Rect> boxes;
+                allocFrames.push_back(makeFrame(cv::Size(640, 480), numFaces, pasteFace, boxes));
+            }
+
+            PipelineConfig pipelineConfig;
+            pipelineConfig.modelPath = Assets::modelPath();
+            pipelineConfig.faceCascadePath = Assets::faceCascadePath();
+            pipelineConfig.eyeCascadePath = Assets::eyeCascadePath();
+            pipelineConfig.engine = engineConfig;
+            pipelineConfig.classifyWorkers = 1;
+            pipelineConfig.dropFrames = false;
+            pipelineConfig.quality.enabled = false;
+            pipelineConfig.cache.enabled = false;
+            Pipeline allocPipeline(pipelineConfig);
+
+            // The realtime sink's state, as in main.cpp
+            EmotionSmoother smoother;
+            std::vector<std::string> smoothedLabels;
+            std::vector<float> confidences;
+            std::vector<int> unstableTracks;
+            std::vector<std::string> statusLines(1);
+            statusLines[0].reserve(64);
+            ResultLoggerConfig loggerConfig;
+            loggerConfig.path = "benchmark_results.csv";
+            ResultLogger logger(loggerConfig);
+
+            const int warmupFrames = 30;
+            const int measuredFrames = 100;
+            std::vector<Profiler::ThreadAllocations> before;
+            std::vector<Profiler::ThreadAllocations> after;
+            before.reserve(64);
+            after.reserve(64);
+
+            size_t nextFrame = 0;
+            auto source = [&](cv::Mat& frame) {
+                allocFrames[nextFrame++ % allocFrames.size()].copyTo(frame);
+                return true;
+            };
+            int rendered = 0;
+            auto sink = [&](FrameResult& result) {
+                smoothedLabels.resize(result.predictions.size());
+                confidences.resize(result.predictions.size());
+                unstableTracks.clear();
+                for (size_t i = 0; i < result.predictions.size(); ++i) {
+                    const auto& prediction = result.predictions[i];
+                    logger.log(result.index, result.trackIds[i], result.faces[i], emotionLabel(prediction),
+                               prediction.confidence, result.usedTTA || result.escalated[i], -1, -1);
+
+                    PROFILE_SCOPE(Smoothing);
+                    SmoothedEmotion smoothed = smoother.update(result.trackIds[i], prediction);
+                    smoothedLabels[i] = emotionLabel(smoothed.classId);
+                    confidences[i] = smoothed.confidence;
+                    if (smoother.isUnstable(result.trackIds[i])) {
+                        unstableTracks.push_back(result.trackIds[i]);
+                    }
+                }
+                smoother.endFrame();
+                allocPipeline.setUnstableTracks(unstableTracks);
+                {
+                    PROFILE_SCOPE(Render);
+                    VideoOverlay::drawDetections(result.frame, result.faces, smoothedLabels, confidences);
+                    char line[64];
+                    std::snprintf(line, sizeof(line), "Frame %llu: %zu faces",
+                                  static_cast<unsigned long long>(result.index), result.faces.size());
+                    statusLines[0].assign(line);
+                    VideoOverlay::drawStats(result.frame, statusLines);
+                }
+
+                // Snapshots bracket the measured frames; the reserved vectors keep them allocation-free
+                ++rendered;
+                if (rendered == warmupFrames) Profiler::allocations(before);
+                if (rendered < warmupFrames + measuredFrames) return true;
+                Profiler::allocations(after);
+                return false;
+            };
+            allocPipeline.run(source, sink);
+            logger.close();
+            cv::setNumThreads(previousThreads);
+
+            // Name each thread by the stage scopes it ran during the measured frames. Haar
+            // detection, eye estimation (align on the detect thread) and the forward pass
+            // allocate inside OpenCV / the runtime and are only reported.
+            std::vector<AllocationStage> stages;
+            uint64_t forwardPasses = 0;
+            for (size_t t = 0; t < after.size(); ++t) {
+                const Profiler::ThreadAllocations base = t < before.size() ? before[t] : Profiler::ThreadAllocations();
+                auto ran = [&](Profiler::Stage stage) {
+                    const int s = static_cast<int>(stage);
+                    return after[t].scopes[s] > base.scopes[s];
+                };
+                const char* thread = ran(Profiler::Stage::Capture) ? "capture"
+                                   : ran(Profiler::Stage::Detect) ? "detect"
+                                   : ran(Profiler::Stage::Forward) ? "classify"
+                                   : ran(Profiler::Stage::Render) ? "render" : nullptr;
+                if (!thread) continue;
+                const bool detectThread = ran(Profiler::Stage::Detect);
+                forwardPasses += after[t].scopes[static_cast<int>(Profiler::Stage::Forward)] -
+                                 base.scopes[static_cast<int>(Profiler::Stage::Forward)];
+
+                for (int s = 0; s < static_cast<int>(Profiler::Stage::Count); ++s) {
+                    const auto stage = static_cast<Profiler::Stage>(s);
+                    if (!ran(stage)) continue;
+                    const bool internal = stage == Profiler::Stage::Forward ||
+                                          (detectThread && (stage == Profiler::Stage::Detect ||
+                                                            stage == Profiler::Stage::Align));
+                    stages.push_back({std::string(thread) + "/" + Profiler::stageName(stage), !internal,
+                                      after[t].byStage[s] - base.byStage[s]});
+                }
+                stages.push_back({std::string(thread) + "/outside stages", true, after[t].outside - base.outside});
+            }
+
+            std::cout << "\nHeap allocations per frame after " << warmupFrames << " warm-up frames ("
+                      << measuredFrames << " frames, 640x480, 1-4 faces, real pipeline and sink)\n";
+            for (const auto& stage : stages) {
+                bool failed = stage.mustBeZero && stage.allocations > 0;
+                allocationFailures += failed ? 1 : 0;
+                std::cout << (failed ? "ALLOCATES  " : "           ") << std::left << std::setw(33) << stage.name
+                          << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+                          << static_cast<double>(stage.allocations) / measuredFrames
+                          << (stage.mustBeZero ? "" : "   (OpenCV internal, not checked)") << "\n";
+            }
+            // Without detected faces the per-face stages never ran, so nothing was checked for them
+            if (forwardPasses == 0) {
+                std::cout << "No faces were classified; pass --face with a real face crop\n";
+                allocationFailures += 1;
+            }
+        }
+#endif
+
+        writeJson(jsonPath, results);
+        std::cout << "Results written to " << jsonPath << "\n";
+
+        // ---- Comparison against a stored baseline ----
+        if (!baselinePath.empty()) {
+            std::map<std::string, double> baseline = readBaseline(baselinePath);
+            int regressions = 0;
+            std::cout << "\nComparison with " << baselinePath << " (p50, tolerance " << tolerance << "%)\n";
+            for (const auto& r : results) {
+                auto it = baseline.find(r.id);
+                if (it == baseline.end() || it->second <= 0) continue;
+                double change = (r.p50Ms - it->second) / it->second * 100.0;
+                bool regressed = change > tolerance;
+                regressions += regressed ? 1 : 0;
+                std::cout << (regressed ? "REGRESSION " : "           ") << std::left << std::setw(44) << r.id
+                          << std::right << std::fixed << std::setprecision(3) << std::setw(10) << it->second
+                          << " -> " << std::setw(10) << r.p50Ms << std::setprecision(1) << std::showpos
+                          << std::setw(9) << change << "%" << std::noshowpos << "\n";
+            }
+            if (regressions > 0) {
+                std::cout << regressions << " benchmark(s) regressed by more than " << tolerance << "%\n";
+                return 2;
+            }
+            std::cout << "No regressions\n";
+        }
+
+        if (checkAllocations && allocationFailures > 0) {
+            std::cout << allocationFailures << " stage(s) allocate in steady state\n";
+            return 2;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // RUN_BENCHMARK
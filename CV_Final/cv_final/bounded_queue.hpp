@@ -0,0 +1,109 @@
+/**
+ * bounded_queue.hpp
+ * Author: Niloofar Karimi
+ * Description: Fixed-capacity lock-free multi-producer / multi-consumer queue used to pass
+ *              work between pipeline stages. Based on the sequence-numbered ring buffer
+ *              design by Dmitry Vyukov. Supports a drop-oldest push for stages that must
+ *              never block on a slower consumer.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class BoundedQueue {
+public:
+    // Constructor: capacity is rounded up to the next power of two
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Try to append an element. Returns false (and leaves `value` untouched) if the queue is full.
+    bool tryPush(T&& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Try to remove the oldest element. Returns false if the queue is empty.
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Append an element, evicting the oldest queued elements while the queue is full.
+    // Every evicted element is handed to onDrop so the caller can account for it.
+    template <typename OnDrop>
+    void pushDropOldest(T&& value, OnDrop onDrop) {
+        while (!tryPush(std::move(value))) {
+            T evicted;
+            if (tryPop(evicted)) {
+                onDrop(evicted);
+            }
+        }
+    }
+
+    // Approximate number of queued elements (exact only when no other thread is active)
+    size_t sizeApprox() const {
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool emptyApprox() const { return sizeApprox() == 0; }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueuePos;   // Next slot a producer will claim
+    alignas(64) std::atomic<size_t> dequeuePos;   // Next slot a consumer will claim
+};
@@ -0,0 +1,126 @@
+/**
+ * calibrate.cpp
+ * Author: Niloofar Karimi
+ * Description: Builds the INT8 calibration set from a labelled image folder (same layout as
+ *              batch_test: one subfolder of images per emotion). Picks an evenly spaced,
+ *              class-balanced subset, applies the batch_test preprocessing (histogram
+ *              equalization, then the model's crop/resize/normalize kernel) and writes the
+ *              resulting [N, 64, 64, 1] tensor as a .npy file.
+ *
+ *              The file is used directly by the OpenCV engine for INT8 (static quantization at
+ *              load time, config::INT8_CALIBRATION_PATH), and can be fed to ONNX Runtime's
+ *              quantize_static() to produce a quantized model for config::INT8_MODEL_PATH.
+ *
+ * Usage: calibrate <image_dir> [--per-class 32] [--output calibration.npy]
+ */
+
+#ifdef RUN_CALIBRATE
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "calibration.hpp"
+#include "config.hpp"
+#include "preprocess.hpp"
+
+namespace fs = std::filesystem;
+
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <image_dir> [--per-class N] [--output calibration.npy]\n"
+              << "  image_dir    folder with one subfolder of images per emotion label\n"
+              << "  --per-class  images sampled from each label (default: 32)\n"
+              << "  --output     calibration tensor to write (default: " << config::INT8_CALIBRATION_PATH << ")\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::string imageDir;
+        std::string outputPath = config::INT8_CALIBRATION_PATH;
+        int perClass = 32;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--per-class" && i + 1 < argc) {
+                perClass = std::stoi(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (imageDir.empty() && arg.rfind("--", 0) != 0) {
+                imageDir = arg;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (imageDir.empty() || perClass < 1) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!fs::is_directory(imageDir)) {
+            std::cerr << "Directory '" << imageDir << "' does not exist.\n";
+            return 1;
+        }
+
+        // Group image paths by their label folder, sorted for a deterministic selection
+        std::map<std::string, std::vector<fs::path>> byLabel;
+        for (const auto& entry : fs::recursive_directory_iterator(imageDir)) {
+            if (!entry.is_regular_file()) continue;
+            byLabel[entry.path().parent_path().filename().string()].push_back(entry.path());
+        }
+
+        // Evenly spaced picks across each class so the set covers the whole folder
+        std::vector<fs::path> selected;
+        for (auto& [label, paths] : byLabel) {
+            std::sort(paths.begin(), paths.end());
+            size_t count = std::min(paths.size(), static_cast<size_t>(perClass));
+            for (size_t k = 0; k < count; ++k) {
+                selected.push_back(paths[k * paths.size() / count]);
+            }
+            std::cout << label << ": " << count << " of " << paths.size() << " images\n";
+        }
+
+        // Preprocess exactly like batch_test + EmotionClassifier into one tensor
+        cv::Size inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT);
+        int shape[] = {static_cast<int>(selected.size()), inputSize.height, inputSize.width, 1};
+        cv::Mat tensor(4, shape, CV_32F);
+        PreprocessScratch scratch;
+        int written = 0;
+        for (const auto& path : selected) {
+            cv::Mat img = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
+            if (img.empty()) {
+                std::cerr << "Failed to read image: " << path.string() << std::endl;
+                continue;
+            }
+            cv::equalizeHist(img, img);
+            preprocessInto(img, inputSize, batchSlot(tensor, written), scratch);
+            ++written;
+        }
+        if (written == 0) {
+            std::cerr << "No readable images found in '" << imageDir << "'.\n";
+            return 1;
+        }
+
+        // Drop slots of unreadable images
+        int finalShape[] = {written, inputSize.height, inputSize.width, 1};
+        cv::Mat calibration(4, finalShape, CV_32F, tensor.data);
+        writeCalibrationTensor(outputPath, calibration);
+        std::cout << "Wrote " << written << " calibration images to " << outputPath << "\n";
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // RUN_CALIBRATE
@@ -0,0 +1,94 @@
+/**
+ * calibration.cpp
+ * Author: Niloofar Karimi
+ * Description: Reads and writes calibration tensors in the NumPy .npy (version 1.0) format.
+ */
+
+#include "calibration.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+static const char NPY_MAGIC[] = "\x93NUMPY";
+
+void writeCalibrationTensor(const std::string& path, const cv::Mat& tensor) {
+    if (tensor.type() != CV_32F || !tensor.isContinuous() || tensor.dims < 2) {
+        throw std::runtime_error("Calibration tensor must be a continuous CV_32F matrix");
+    }
+
+    std::ostringstream shape;
+    for (int i = 0; i < tensor.dims; ++i) {
+        shape << tensor.size[i] << (i + 1 < tensor.dims ? ", " : "");
+    }
+    std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + shape.str() + "), }";
+
+    // Pad with spaces so the data starts on a 64-byte boundary; the header ends with '\n'
+    const size_t preamble = 6 + 2 + 2;
+    size_t total = preamble + header.size() + 1;
+    header.append((64 - total % 64) % 64, ' ');
+    header += '\n';
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open calibration file for writing: " + path);
+    }
+    unsigned short headerLength = static_cast<unsigned short>(header.size());
+    out.write(NPY_MAGIC, 6);
+    out.put(1);
+    out.put(0);
+    out.put(static_cast<char>(headerLength & 0xFF));
+    out.put(static_cast<char>(headerLength >> 8));
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(tensor.data), static_cast<std::streamsize>(tensor.total() * sizeof(float)));
+    if (!out) {
+        throw std::runtime_error("Failed to write calibration file: " + path);
+    }
+}
+
+cv::Mat readCalibrationTensor(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open calibration file: " + path);
+    }
+
+    char magic[6];
+    in.read(magic, 6);
+    int major = in.get();
+    in.get();   // Minor version
+    if (!in || std::string(magic, 6) != std::string(NPY_MAGIC, 6) || major != 1) {
+        throw std::runtime_error("Not a version 1.0 .npy file: " + path);
+    }
+    unsigned char lengthBytes[2];
+    in.read(reinterpret_cast<char*>(lengthBytes), 2);
+    std::string header(lengthBytes[0] | (lengthBytes[1] << 8), '\0');
+    in.read(&header[0], static_cast<std::streamsize>(header.size()));
+
+    if (header.find("'<f4'") == std::string::npos || header.find("'fortran_order': False") == std::string::npos) {
+        throw std::runtime_error("Calibration file must hold C-ordered float32 data: " + path);
+    }
+
+    // Parse "(N, H, W, C)" after 'shape':
+    size_t open = header.find('(', header.find("'shape'"));
+    size_t close = header.find(')', open);
+    if (open == std::string::npos || close == std::string::npos) {
+        throw std::runtime_error("Malformed .npy header: " + path);
+    }
+    std::vector<int> dims;
+    std::istringstream shape(header.substr(open + 1, close - open - 1));
+    std::string item;
+    while (std::getline(shape, item, ',')) {
+        if (item.find_first_not_of(' ') != std::string::npos) dims.push_back(std::stoi(item));
+    }
+    if (dims.size() < 2) {
+        throw std::runtime_error("Calibration tensor must have at least 2 dimensions: " + path);
+    }
+
+    cv::Mat tensor(static_cast<int>(dims.size()), dims.data(), CV_32F);
+    in.read(reinterpret_cast<char*>(tensor.data), static_cast<std::streamsize>(tensor.total() * sizeof(float)));
+    if (!in) {
+        throw std::runtime_error("Calibration file is truncated: " + path);
+    }
+    return tensor;
+}
@@ -0,0 +1,18 @@
+/**
+ * calibration.hpp
+ * Author: Niloofar Karimi
+ * Description: Calibration tensors for INT8 quantization. A calibration set is a
+ *              [N, H, W, 1] float tensor of preprocessed faces stored as a NumPy .npy file,
+ *              so the same file feeds OpenCV's Net::quantize() and ONNX Runtime's
+ *              quantize_static() tooling.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <string>
+
+// Write a 4-D CV_32F tensor as a little-endian float32 .npy file (throws std::runtime_error)
+void writeCalibrationTensor(const std::string& path, const cv::Mat& tensor);
+
+// Read a float32 .npy file written by writeCalibrationTensor (throws std::runtime_error)
+cv::Mat readCalibrationTensor(const std::string& path);
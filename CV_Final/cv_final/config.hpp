@@ -6,16 +6,38 @@
  */
 
 #pragma once
+#include <cstddef>
 #include <string>
 #include <vector>
 
 namespace config {
 
-    // Path to the ONNX emotion classification model
-    const std::string MODEL_PATH = "/Users/niloofarkarimi/CV_Final/models/mini_xception.onnx";
+    // Directory holding the model and the cascades (the CV_Final folder). Assets are looked up
+    // in the --assets directory or $EMOTION_ASSETS first, then among the assets built into the
+    // binary (-DEMBED_ASSETS), then here (see assets.hpp).
+    const std::string ASSET_DIR = "/Users/niloofarkarimi/CV_Final";
+    const char* const ASSET_DIR_ENV = "EMOTION_ASSETS";
 
-    // Path to Haar cascade XML for face detection
-    const std::string FACE_CASCADE_PATH = "/Users/niloofarkarimi/CV_Final/resources/haarcascade_frontalface_default.xml";
+    // ONNX emotion classification model, relative to the asset directory
+    const std::string MODEL_FILE = "models/mini_xception.onnx";
+
+    // Haar cascade XML for face detection
+    const std::string FACE_CASCADE_FILE = "resources/haarcascade_frontalface_default.xml";
+
+    // Haar cascade XML for eye detection (face alignment)
+    const std::string EYE_CASCADE_FILE = "resources/haarcascade_eye.xml";
+
+    // Full default paths
+    const std::string MODEL_PATH = ASSET_DIR + "/" + MODEL_FILE;
+    const std::string FACE_CASCADE_PATH = ASSET_DIR + "/" + FACE_CASCADE_FILE;
+    const std::string EYE_CASCADE_PATH = ASSET_DIR + "/" + EYE_CASCADE_FILE;
+
+    // Startup: run each classifier once on a dummy input before the first frame, so lazy
+    // network setup is not paid by a live frame
+    const bool WARMUP_INFERENCE = true;
+
+    // Startup: print when each startup phase ran and how long it took
+    const bool PRINT_STARTUP_REPORT = true;
 
     // Input dimensions expected by the ONNX model
     const int INPUT_WIDTH = 64;
@@ -26,6 +48,222 @@ namespace config {
         "Anger", "Disgust", "Fear", "Happy", "Sad", "Surprise", "Neutral"
     };
 
+    // Number of classes output by the model (one per entry of EMOTION_LABELS)
+    const int NUM_EMOTIONS = 7;
+
+    // Ranked classes kept in each prediction (EmotionPrediction::topK)
+    const int PREDICTION_TOP_K = 3;
+
+    // Predictions whose top probability is below this are reported as "Uncertain"
+    const float UNCERTAIN_THRESHOLD = 0.2f;
+
+    // Test-time augmentation variants: horizontal flip and rotations (in degrees).
+    // The original image is always included as the first variant.
+    const bool TTA_USE_FLIP = true;
+    const std::vector<double> TTA_ROTATION_ANGLES = { -10.0, 10.0 };
+
+    // TTA at startup: "off", "on" (every face) or "adaptive" (low-confidence faces only)
+    const std::string TTA_MODE = "off";
+
+    // Adaptive TTA: a face is escalated to the augmented variants when its single-pass top
+    // probability, or its lead over the runner-up, is below these thresholds
+    const float TTA_ADAPTIVE_CONFIDENCE = 0.6f;
+    const float TTA_ADAPTIVE_MARGIN = 0.2f;
+
+    // Adaptive TTA: extra image forwards allowed per frame (each escalated face costs one per
+    // non-original variant; -1 = unlimited)
+    const int TTA_ADAPTIVE_MAX_EXTRA_FORWARDS = 12;
+
+    // Maximum number of images sent through the network in one forward pass
+    const int MAX_BATCH_SIZE = 32;
+
+    // Face detection: detectMultiScale pyramid step and neighbour hits needed to keep a face
+    const double DETECT_SCALE_FACTOR = 1.1;
+    const int DETECT_MIN_NEIGHBORS = 3;
+
+    // Face detection: smallest face searched for, in full-resolution pixels
+    const int DETECT_MIN_FACE_SIZE = 30;
+
+    // Face detection: frames wider than this are downscaled before full-frame detection
+    // (0 = always detect at full resolution). Faces smaller than the cascade window (24 px)
+    // after downscaling are not found, so a limit raises the smallest detectable face above
+    // DETECT_MIN_FACE_SIZE (e.g. 960 makes it about 48 px at 1080p); off by default
+    const int DETECT_MAX_WIDTH = 0;
+
+    // Face detection: search only sizes near those detected recently (from the last
+    // DETECT_ADAPTIVE_HISTORY faces). The full range is searched again at least every
+    // DETECT_FULL_SCAN_INTERVAL_MS, however rarely full-frame detection runs (tracker keyframes)
+    const bool DETECT_ADAPTIVE_SIZES = true;
+    const int DETECT_ADAPTIVE_HISTORY = 32;
+    const double DETECT_FULL_SCAN_INTERVAL_MS = 500.0;
+
+    // Face detection: grid of overlapping tiles evaluated in parallel (1 x 1 = single pass)
+    const int DETECT_TILE_ROWS = 2;
+    const int DETECT_TILE_COLS = 2;
+
+    // Face alignment: faces are resized to this width and only their upper half is searched for eyes
+    const int ALIGN_EYE_SEARCH_WIDTH = 96;
+
+    // Face alignment: re-run the eye search for a tracked face every N frames, or earlier when
+    // its box moves or resizes by more than the given fraction of the face size
+    const int ALIGN_REFRESH_INTERVAL = 15;
+    const float ALIGN_POSE_CHANGE_THRESHOLD = 0.25f;
+
+    // Face tracking: follow faces between keyframes instead of detecting on every frame
+    const bool USE_FACE_TRACKING = true;
+
+    // Face tracking: run full-frame detection every N frames; in between, faces are followed
+    // by template matching and re-detected only inside expanded regions around each track
+    const int TRACKER_DETECT_INTERVAL = 10;
+
+    // Face tracking: force a full detection when any track's confidence drops below this
+    const float TRACKER_MIN_CONFIDENCE = 0.6f;
+
+    // Face tracking: minimum IoU for a detection to be associated with an existing track
+    const float TRACKER_IOU_THRESHOLD = 0.3f;
+
+    // Face tracking: search region around a track, as a fraction of the face size on each side
+    const float TRACKER_ROI_EXPANSION = 0.3f;
+
+    // Face tracking: number of keyframes a track may go undetected before it is removed
+    const int TRACKER_MAX_MISSED = 1;
+
+    // Prediction smoothing per track: "ema" (moving average of the probabilities), "vote"
+    // (majority of the last SMOOTHING_WINDOW classes) or "off"
+    const std::string SMOOTHING_MODE = "ema";
+
+    // Prediction smoothing: weight of the newest probabilities in the moving average
+    const float SMOOTHING_EMA_ALPHA = 0.3f;
+
+    // Prediction smoothing: number of recent predictions in the majority vote
+    const int SMOOTHING_WINDOW = 5;
+
+    // Prediction smoothing: hysteresis. The displayed emotion only changes when another class
+    // leads it by this margin (in average probability, or in vote share)
+    const float SMOOTHING_HYSTERESIS = 0.1f;
+
+    // Prediction smoothing: tracks with state at once, and frames a track may go unseen
+    // before its state is dropped
+    const int SMOOTHING_MAX_TRACKS = 64;
+    const int SMOOTHING_STALE_FRAMES = 30;
+
+    // Realtime pipeline: capacity of each inter-stage queue (oldest frames are dropped when full)
+    const int PIPELINE_QUEUE_CAPACITY = 4;
+
+    // Realtime pipeline: number of classification workers (0 = derive from the core count)
+    const int PIPELINE_CLASSIFY_WORKERS = 0;
+
+    // Result cache: a tracked face whose model-input crop differs from the one last classified
+    // by at most this mean absolute difference (16 x 16 block means, gray levels) reuses that
+    // prediction, for at most RESULT_CACHE_MAX_AGE frames before it is classified again
+    const bool RESULT_CACHE_ENABLED = true;
+    const double RESULT_CACHE_MAX_DIFF = 3.0;
+    const int RESULT_CACHE_MAX_AGE = 15;
+
+    // Load shedding (live and paced sources): hold this frame rate and capture-to-render
+    // latency by degrading quality step by step (TTA, alignment, reuse, detection size, frames)
+    const bool SHED_ENABLED = true;
+    const double SHED_TARGET_FPS = 15.0;
+    const double SHED_LATENCY_SLO_MS = 200.0;
+
+    // Load shedding: restore a level only while costs stay below this fraction of the limits
+    // for SHED_HOLD_FRAMES frames; every change is also held that long before the next one
+    const double SHED_RESTORE_HEADROOM = 0.7;
+    const int SHED_HOLD_FRAMES = 15;
+
+    // Load shedding: weight of the newest frame in the smoothed stage costs
+    const double SHED_COST_SMOOTHING = 0.2;
+
+    // Load shedding: detection width at the low-resolution level, and how many frames a
+    // stable track may reuse its classification before it is refreshed
+    const int SHED_LOW_RES_DETECT_WIDTH = 480;
+    const int SHED_REUSE_MAX_AGE = 10;
+
+    // Multi-stream server: shared worker pool size, each worker holding one classifier, face
+    // detector and eye cascade (0 = one per hardware thread)
+    const int STREAM_WORKERS = 0;
+
+    // Multi-stream server: frames per second processed per source unless given per source
+    const double STREAM_DEFAULT_FPS = 15.0;
+
+    // Multi-stream server: decoded frames buffered ahead per file source (kept small, since
+    // it is the only per-stream frame memory)
+    const int STREAM_READ_AHEAD = 2;
+
+    // Multi-stream server: send every worker's faces through one shared InferenceBatcher
+    // (one model, large batches) instead of a classifier per worker
+    const bool STREAM_BATCH_INFERENCE = false;
+
+    // Request batching: longest time the oldest queued face waits for more faces before the
+    // batch is run (batches also run as soon as MAX_BATCH_SIZE faces are queued)
+    const double BATCHER_MAX_DELAY_MS = 2.0;
+
+    // Multi-stream server: how often per-stream throughput is printed
+    const double STREAM_REPORT_INTERVAL_SEC = 5.0;
+
+    // Inference: engine used by EmotionClassifier ("opencv" or "onnxruntime"; the latter needs
+    // a build with -DHAVE_ONNXRUNTIME)
+    const std::string INFERENCE_BACKEND = "opencv";
+
+    // Inference (OpenCV DNN): cv::dnn::Backend and cv::dnn::Target values
+    // (0 = DNN_BACKEND_DEFAULT, 0 = DNN_TARGET_CPU)
+    const int DNN_BACKEND = 0;
+    const int DNN_TARGET = 0;
+
+    // Inference: worker threads per forward pass (0 = library default). For OpenCV DNN this
+    // calls cv::setNumThreads, which affects the whole process
+    const int INFERENCE_THREADS = 0;
+
+    // Inference (ONNX Runtime): inter-op threads (0 = library default) and graph optimization
+    // level (0 = disabled, 1 = basic, 2 = extended, 3 = all)
+    const int ORT_INTER_OP_THREADS = 1;
+    const int ORT_GRAPH_OPTIMIZATION_LEVEL = 3;
+
+    // Inference: numeric precision ("fp32", "fp16" where the backend supports it, or "int8")
+    const std::string INFERENCE_PRECISION = "fp32";
+
+    // INT8: statically quantized model. Leave empty to have OpenCV DNN quantize the FP32 model
+    // at load time using the calibration tensor below (written by the calibrate tool)
+    const std::string INT8_MODEL_PATH = "";
+    const std::string INT8_CALIBRATION_PATH = "calibration.npy";
+
+    // Reduced precision: largest accuracy drop versus FP32 (percentage points) that batch_test accepts
+    const double PRECISION_ACCURACY_TOLERANCE = 1.0;
+
+    // Frame sources: decoded frames buffered ahead of the pipeline for video/image inputs
+    const size_t READ_AHEAD_FRAMES = 8;
+
+    // Frame sources: frame rate used for image directories and videos without FPS metadata
+    const double DEFAULT_SEQUENCE_FPS = 30.0;
+
+    // Frame sources: read only the Y (luma) plane, skipping the BGR decode and the grayscale
+    // conversion; frames that are shown or recorded are converted to color in the render sink
+    const bool LUMA_INGEST = true;
+
+    // Headless mode: how often the achieved FPS is printed
+    const double HEADLESS_REPORT_INTERVAL_SEC = 2.0;
+
+    // Result logging: output file (".bin" selects the columnar binary format, anything else CSV)
+    const std::string RESULTS_PATH = "results.csv";
+
+    // Result logging: records buffered between the render loop and the writer thread;
+    // results arriving while the buffer is full are dropped and counted
+    const size_t LOG_QUEUE_CAPACITY = 4096;
+
+    // Result logging: also print each result to the console (batched by the writer thread)
+    const bool LOG_ECHO_TO_CONSOLE = true;
+
+    // Quiet mode: stop EmotionClassifier::classify() and classifyWithTTA() printing each prediction
+    const bool CLASSIFIER_QUIET = false;
+
+    // Profiling (builds with -DENABLE_PROFILING only): per-stage latency report file
+    // (".json" writes JSON lines, anything else CSV) and how often it is written
+    const std::string PROFILE_OUTPUT_PATH = "profile.csv";
+    const double PROFILE_FLUSH_INTERVAL_SEC = 1.0;
+
+    // Profiling: show the latency HUD on the video at startup (toggle with 'P')
+    const bool SHOW_PROFILER_HUD = true;
+
     // Minimum confidence threshold for valid detection (if DNN face detection is used)
     const float CONFIDENCE_THRESHOLD = 0.5;
 
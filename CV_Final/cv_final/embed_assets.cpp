@@ -0,0 +1,114 @@
+/**
+ * embed_assets.cpp
+ * Author: Niloofar Karimi
+ * Description: Writes the model and the Haar cascades from an asset directory into a C++
+ *              source fragment (embedded_assets.inc). Building the apps with -DEMBED_ASSETS
+ *              compiles it in, so they start without any asset files on disk (see assets.hpp).
+ *
+ * Usage: embed_assets [asset_dir] [--output embedded_assets.inc]
+ */
+
+#ifdef RUN_EMBED
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "assets.hpp"
+#include "config.hpp"
+
+namespace fs = std::filesystem;
+
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [asset_dir] [--output embedded_assets.inc]\n"
+              << "  asset_dir  folder with " << config::MODEL_FILE << ", " << config::FACE_CASCADE_FILE << " and "
+              << config::EYE_CASCADE_FILE << "\n"
+              << "             (default: $" << config::ASSET_DIR_ENV << " or " << config::ASSET_DIR << ")\n"
+              << "  --output   source fragment to write (default: embedded_assets.inc)\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::string assetDir;
+        std::string outputPath = "embedded_assets.inc";
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (assetDir.empty() && arg.rfind("--", 0) != 0) {
+                assetDir = arg;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (assetDir.empty()) assetDir = Assets::directory();
+        if (assetDir.empty()) assetDir = config::ASSET_DIR;
+        Assets::setDirectory(assetDir);
+
+        std::ofstream out(outputPath);
+        if (!out) {
+            std::cerr << "Could not write '" << outputPath << "'.\n";
+            return 1;
+        }
+        out << "// Generated by embed_assets from " << assetDir << "; do not edit.\n";
+
+        // One byte array per asset, then the table assets.cpp searches by file name
+        const std::vector<std::string> files = {config::MODEL_FILE, config::FACE_CASCADE_FILE, config::EYE_CASCADE_FILE};
+        std::vector<std::string> names;
+        size_t totalBytes = 0;
+        for (size_t index = 0; index < files.size(); ++index) {
+            const std::string path = Assets::resolve(files[index]);
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                std::cerr << "Could not read asset '" << path << "'.\n";
+                return 1;
+            }
+            std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (bytes.empty()) {
+                std::cerr << "Asset '" << path << "' is empty.\n";
+                return 1;
+            }
+
+            out << "\nstatic const unsigned char EMBEDDED_ASSET_" << index << "[] = {";
+            const char* hex = "0123456789abcdef";
+            for (size_t i = 0; i < bytes.size(); ++i) {
+                out << (i % 16 == 0 ? "\n    " : " ") << "0x" << hex[bytes[i] >> 4] << hex[bytes[i] & 15] << ',';
+            }
+            out << "\n};\n";
+            names.push_back(fs::path(files[index]).filename().string());
+            totalBytes += bytes.size();
+            std::cout << "Embedded " << path << " (" << bytes.size() / 1024 << " KiB)\n";
+        }
+
+        out << "\nstatic const Assets::EmbeddedAsset EMBEDDED_ASSETS[] = {\n";
+        for (size_t index = 0; index < names.size(); ++index) {
+            out << "    {\"" << names[index] << "\", EMBEDDED_ASSET_" << index << ", sizeof(EMBEDDED_ASSET_" << index
+                << ")},\n";
+        }
+        out << "};\n";
+        out.close();
+        if (!out) {
+            std::cerr << "Could not write '" << outputPath << "'.\n";
+            return 1;
+        }
+        std::cout << "Wrote " << outputPath << " (" << totalBytes / 1024
+                  << " KiB of assets); build with -DEMBED_ASSETS to compile them in\n";
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // RUN_EMBED
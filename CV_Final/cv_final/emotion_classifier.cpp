@@ -2,152 +2,411 @@
  * emotion_classifier.cpp
  * Author: Niloofar Karimi
  * Description: Implements the EmotionClassifier class for performing emotion prediction
- *              using a CNN model in ONNX format. Includes preprocessing and
- *              test-time augmentation (TTA) support.
+ *              using a CNN model in ONNX format run by an InferenceEngine. Includes batched inference into a
+ *              preallocated input tensor and test-time augmentation (TTA) support.
  */
 
 #include "emotion_classifier.hpp"
 #include "config.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
 
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
-#include <opencv2/dnn.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
-#include <cstring>
 
-// Constructor: load the ONNX model and store input shape and emotion labels
-EmotionClassifier::EmotionClassifier(const std::string& modelPath)
-    : inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT), labels(config::EMOTION_LABELS) {
+// Constructor: load the ONNX model and store the input shape
+EmotionClassifier::EmotionClassifier(const std::string& modelPath, const InferenceEngineConfig& engineConfig)
+    : engine(createInferenceEngine(modelPath, engineConfig)),
+      inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT),
+      augmentations(defaultAugmentations()), maxBatchSize(config::MAX_BATCH_SIZE),
+      quiet(config::CLASSIFIER_QUIET) {
 
-    net = cv::dnn::readNetFromONNX(modelPath);
-    if (net.empty()) {
-        throw std::runtime_error("Failed to load ONNX model from path: " + modelPath);
+    setMaxBatchSize(maxBatchSize);
+}
+
+// Apply a single augmentation (flip and/or rotation about the center) to a face image,
+// writing into `dst`. The flip is folded into the affine matrix, so the source is left
+// untouched and a reused `dst` is not reallocated.
+static void augmentInto(const cv::Mat& faceROI, const Augmentation& aug, cv::Mat& dst) {
+    cv::Point2d center(faceROI.cols / 2.0, faceROI.rows / 2.0);
+    cv::Matx23d m = Utils::rotationMatrix(center, aug.angle, 1.0);
+    if (aug.flip) {
+        // Compose with x -> cols - 1 - x
+        const double w = faceROI.cols - 1.0;
+        m = cv::Matx23d(-m(0, 0), m(0, 1), m(0, 0) * w + m(0, 2),
+                        -m(1, 0), m(1, 1), m(1, 0) * w + m(1, 2));
     }
+    cv::warpAffine(faceROI, dst, m, faceROI.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
 }
 
-// Preprocess a single grayscale face image: center-crop, resize, normalize to [-1, 1]
-cv::Mat preprocess(const cv::Mat& faceROI, const cv::Size& targetSize) {
-    int cropSize = std::min(faceROI.rows, faceROI.cols);
-    int offsetX = (faceROI.cols - cropSize) / 2;
-    int offsetY = (faceROI.rows - cropSize) / 2;
-    cv::Rect roi(offsetX, offsetY, cropSize, cropSize);
-    cv::Mat cropped = faceROI(roi);
+// Softmax of one row of raw model scores. The class count is a compile-time constant, so
+// the loops are fully unrolled; subtracting the row maximum keeps exp() from overflowing.
+static void softmaxRow(const float* scores, float* probs) {
+    float maxScore = scores[0];
+    for (int c = 1; c < config::NUM_EMOTIONS; ++c) maxScore = std::max(maxScore, scores[c]);
+    float sum = 0.0f;
+    for (int c = 0; c < config::NUM_EMOTIONS; ++c) {
+        probs[c] = std::exp(scores[c] - maxScore);
+        sum += probs[c];
+    }
+    const float inv = 1.0f / sum;
+    for (int c = 0; c < config::NUM_EMOTIONS; ++c) probs[c] *= inv;
+}
 
-    cv::Mat resized;
-    cv::resize(cropped, resized, targetSize);
-    resized.convertTo(resized, CV_32F, 1.0 / 255.0); // Normalize to [0,1]
-    resized = (resized - 0.5f) / 0.5f; // Normalize to [-1,1]
+// Fill classId, confidence and topK from the probabilities (ties go to the lower index)
+static void rankClasses(EmotionPrediction& prediction) {
+    const auto& probs = prediction.probabilities;
+    std::array<int, config::NUM_EMOTIONS> order;
+    for (int c = 0; c < config::NUM_EMOTIONS; ++c) order[c] = c;
+    std::partial_sort(order.begin(), order.begin() + config::PREDICTION_TOP_K, order.end(),
+                      [&probs](int a, int b) { return probs[a] > probs[b] || (probs[a] == probs[b] && a < b); });
+    std::copy(order.begin(), order.begin() + config::PREDICTION_TOP_K, prediction.topK.begin());
+    prediction.classId = order[0];
+    prediction.confidence = probs[order[0]];
+}
 
-    return resized;
+const std::string& emotionLabel(int classId) {
+    static const std::string uncertain = "Uncertain";
+    static const std::string unknown = "Unknown";
+    if (classId < 0) return uncertain;
+    return classId < static_cast<int>(config::EMOTION_LABELS.size()) ? config::EMOTION_LABELS[classId] : unknown;
 }
 
-// Predict the emotion from a single face image (no confidence returned)
-std::string EmotionClassifier::classify(const cv::Mat& faceROI) {
-    return classify(faceROI, nullptr);
+const std::string& emotionLabel(const EmotionPrediction& prediction) {
+    return emotionLabel(prediction.isUncertain() ? -1 : prediction.classId);
 }
 
-// Predict the emotion and output the confidence of the top prediction
-std::string EmotionClassifier::classify(const cv::Mat& faceROI, float* confidence) {
-    cv::Mat processed = preprocess(faceROI, inputSize);
+TtaMode parseTtaMode(const std::string& name) {
+    if (name == "off") return TtaMode::Off;
+    if (name == "on") return TtaMode::On;
+    if (name == "adaptive") return TtaMode::Adaptive;
+    throw std::invalid_argument("Unknown TTA mode: " + name + " (expected off, on or adaptive)");
+}
+
+const char* ttaModeName(TtaMode mode) {
+    switch (mode) {
+        case TtaMode::On: return "on";
+        case TtaMode::Adaptive: return "adaptive";
+        default: return "off";
+    }
+}
+
+AdaptiveTtaConfig::AdaptiveTtaConfig()
+    : confidenceThreshold(config::TTA_ADAPTIVE_CONFIDENCE),
+      marginThreshold(config::TTA_ADAPTIVE_MARGIN),
+      maxExtraForwards(config::TTA_ADAPTIVE_MAX_EXTRA_FORWARDS) {}
+
+// Lead of the top class over the runner-up
+static float marginOf(const EmotionPrediction& prediction) {
+    return prediction.probabilities[prediction.topK[0]] - prediction.probabilities[prediction.topK[1]];
+}
 
-    std::vector<int> shape = {1, inputSize.height, inputSize.width, 1};
-    cv::Mat blob(4, &shape[0], CV_32F);
-    std::memcpy(blob.data, processed.data, processed.total() * sizeof(float));
+// Build the default TTA variants: original, optional flip, and configured rotations
+std::vector<Augmentation> EmotionClassifier::defaultAugmentations() {
+    std::vector<Augmentation> augs = {{false, 0.0}};
+    if (config::TTA_USE_FLIP) {
+        augs.push_back({true, 0.0});
+    }
+    for (double angle : config::TTA_ROTATION_ANGLES) {
+        augs.push_back({false, angle});
+    }
+    return augs;
+}
 
-    net.setInput(blob);
-    cv::Mat output = net.forward();
+void EmotionClassifier::setAugmentations(const std::vector<Augmentation>& augs) {
+    augmentations = augs;
+}
 
-    // Apply softmax to get class probabilities
-    cv::Mat scores = output.reshape(1, 1);
-    cv::Mat expScores;
-    cv::exp(scores, expScores);
-    expScores /= cv::sum(expScores)[0];
+void EmotionClassifier::setMaxBatchSize(int size) {
+    if (size < 1) {
+        throw std::invalid_argument("Max batch size must be at least 1");
+    }
+    maxBatchSize = size;
 
-    // Find the index of the class with highest score
-    cv::Point classIdPoint;
-    double maxVal;
-    cv::minMaxLoc(expScores, nullptr, &maxVal, nullptr, &classIdPoint);
-    int classId = classIdPoint.x;
+    // Allocate the input tensor once; each forward pass uses a view of its first slots
+    int shape[] = {maxBatchSize, inputSize.height, inputSize.width, 1};
+    inputBlob.create(4, shape, CV_32F);
+    blobViews.assign(static_cast<size_t>(maxBatchSize) + 1, cv::Mat());
+}
 
-    if (confidence) {
-        *confidence = static_cast<float>(maxVal);
+cv::Mat& EmotionClassifier::blobView(int count) {
+    cv::Mat& view = blobViews[count];
+    if (view.empty()) {
+        int shape[] = {count, inputSize.height, inputSize.width, 1};
+        view = cv::Mat(4, shape, CV_32F, inputBlob.data);
+    }
+    return view;
+}
+
+void EmotionClassifier::buildVariants(const std::vector<cv::Mat>& faceROIs, const std::vector<Augmentation>& augs) {
+    variants.clear();
+    mirrored.clear();
+    size_t rotated = 0;
+    for (const auto& face : faceROIs) {
+        for (const auto& aug : augs) {
+            if (aug.angle == 0.0) {
+                // Flip is folded into the preprocessing kernel
+                variants.push_back(face);
+                mirrored.push_back(aug.flip ? 1 : 0);
+            } else {
+                if (rotated == rotatedVariants.size()) rotatedVariants.emplace_back();
+                cv::Mat& target = rotatedVariants[rotated++];
+                augmentInto(face, aug, target);
+                variants.push_back(target);
+                mirrored.push_back(0);
+            }
+        }
+    }
+}
+
+void EmotionClassifier::warmUp() {
+    const int ttaBatch = std::min(static_cast<int>(augmentations.size()), maxBatchSize);
+    const int batchSizes[] = {1, ttaBatch};
+    for (int i = 0; i < (ttaBatch > 1 ? 2 : 1); ++i) {
+        cv::Mat& blob = blobView(batchSizes[i]);
+        std::memset(blob.data, 0, blob.total() * blob.elemSize());
+        forward(blob);
+    }
+}
+
+cv::Mat EmotionClassifier::forward(const cv::Mat& blob) {
+    cv::Mat scores;
+    {
+        PROFILE_SCOPE(Forward);
+        scores = engine->infer(blob);
+    }
+    if (scores.cols != config::NUM_EMOTIONS || scores.type() != CV_32F) {
+        throw std::runtime_error("Model outputs " + std::to_string(scores.cols) + " scores per image, expected " +
+                                 std::to_string(config::NUM_EMOTIONS) + " floats");
     }
+    return scores;
+}
 
-    std::string label = (classId >= 0 && classId < labels.size()) ? labels[classId] : "Unknown";
-    std::cout << label << " (" << maxVal << ")" << std::endl;
+// Run inference on a list of images, at most maxBatchSize per forward pass.
+// Returns an N x NUM_EMOTIONS matrix with one softmax probability row per image.
+cv::Mat EmotionClassifier::predictProbabilities(const std::vector<cv::Mat>& images,
+                                                const std::vector<uchar>& mirrored) {
+    const int total = static_cast<int>(images.size());
+    cv::Mat probs;
+
+    for (int start = 0; start < total; start += maxBatchSize) {
+        const int count = std::min(maxBatchSize, total - start);
+
+        // View of the first `count` slots of the preallocated [maxBatchSize, H, W, 1] tensor
+        cv::Mat& blob = blobView(count);
+
+        // Crop, resize and normalize each image straight into its batch slot
+        for (int i = 0; i < count; ++i) {
+            PROFILE_SCOPE(Preprocess);
+            bool mirror = !mirrored.empty() && mirrored[start + i];
+            preprocessInto(images[start + i], inputSize, batchSlot(blob, i), scratch, mirror);
+        }
+
+        // Single forward pass for the whole chunk; output is [count, numClasses]
+        cv::Mat scores = forward(blob);
+
+        if (probs.empty()) {
+            // Grow-only buffer: later requests with as many images reuse it
+            if (probBuffer.rows < total) {
+                probBuffer.create(total, config::NUM_EMOTIONS, CV_32F);
+            }
+            probs = probBuffer.rowRange(0, total);
+        }
+        for (int i = 0; i < count; ++i) {
+            softmaxRow(scores.ptr<float>(i), probs.ptr<float>(start + i));
+        }
+    }
 
-    // Filter low-confidence predictions
-    return (maxVal < 0.2) ? "Uncertain" : label;
+    return probs;
+}
+
+// Classify one face through the batch path (reused one-element request)
+EmotionPrediction EmotionClassifier::predict(const cv::Mat& faceROI, bool useTTA) {
+    singleFace.assign(1, faceROI);
+    classifyBatch(singleFace, useTTA, singlePrediction);
+    singleFace[0].release();   // Do not keep the caller's image alive
+    return singlePrediction[0];
+}
+
+// Predict the emotion from a single face image (no confidence returned)
+std::string EmotionClassifier::classify(const cv::Mat& faceROI) {
+    return classify(faceROI, nullptr);
 }
 
+// Predict the emotion and output the confidence of the top prediction
+std::string EmotionClassifier::classify(const cv::Mat& faceROI, float* confidence) {
+    EmotionPrediction prediction = predict(faceROI, false);
+    const std::string& label = emotionLabel(prediction);
 
+    if (confidence) {
+        *confidence = prediction.confidence;
+    }
 
+    if (!quiet) {
+        std::cout << label << " (" << prediction.confidence << ")" << std::endl;
+    }
+    return label;
+}
 
+// Classify with TTA (no confidence returned)
+std::string EmotionClassifier::classifyWithTTA(const cv::Mat& faceROI) {
+    return classifyWithTTA(faceROI, nullptr);
+}
 
-// Classify with Test-Time Augmentation (TTA): predict using original, flipped, and rotated variants
+// Classify with Test-Time Augmentation (TTA): predict using every configured variant
+// (original, flipped, rotated, ...) packed into one N x H x W x 1 batch
 std::string EmotionClassifier::classifyWithTTA(const cv::Mat& faceROI, float* confidence) {
-    std::vector<cv::Mat> variants = {faceROI};  // Start with original face
+    if (augmentations.empty()) {
+        return classify(faceROI, confidence);
+    }
 
-    // Add horizontally flipped version of the face
-    cv::Mat flipped;
-    cv::flip(faceROI, flipped, 1);
-    variants.push_back(flipped);
+    EmotionPrediction prediction = predict(faceROI, true);
+    const std::string& label = emotionLabel(prediction);
 
-    // Add rotated versions: -10 degrees and +10 degrees
-    for (int angle : {-10, 10}) {
-        cv::Mat rotated;
-        cv::Point2f center(faceROI.cols / 2.0f, faceROI.rows / 2.0f);
-        cv::Mat rot_mat = cv::getRotationMatrix2D(center, angle, 1.0);
-        cv::warpAffine(faceROI, rotated, rot_mat, faceROI.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
-        variants.push_back(rotated);
+    // Store max confidence score if requested
+    if (confidence) {
+        *confidence = prediction.confidence;
     }
 
-    // Initialize a zeroed score vector to accumulate softmax scores across all variants
-    cv::Mat avgScores = cv::Mat::zeros(1, static_cast<int>(labels.size()), CV_32F);
+    if (!quiet) {
+        std::cout << "TTA " << label << " (" << prediction.confidence << ")" << std::endl;
+    }
+    return label;
+}
 
-    // Run inference on each variant and accumulate the softmax outputs
-    for (const auto& img : variants) {
-        // Preprocess (crop, resize, normalize) for input to the model
-        cv::Mat processed = preprocess(img, inputSize);
+// Classify several faces with one forward pass per batch. With TTA, every face contributes
+// all of its variants to the batch and the variant probabilities are averaged per face.
+std::vector<EmotionPrediction> EmotionClassifier::classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA) {
+    std::vector<EmotionPrediction> predictions;
+    classifyBatch(faceROIs, useTTA, predictions);
+    return predictions;
+}
 
-        // Create 4D blob with shape [1, height, width, 1] for grayscale image
-        std::vector<int> shape = {1, inputSize.height, inputSize.width, 1};
-        cv::Mat blob(4, &shape[0], CV_32F);
-        std::memcpy(blob.data, processed.data, processed.total() * sizeof(float));
+void EmotionClassifier::classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA,
+                                      std::vector<EmotionPrediction>& predictions) {
+    predictions.resize(faceROIs.size());
+    if (faceROIs.empty()) {
+        return;
+    }
 
-        // Feed into ONNX model and get raw output
-        net.setInput(blob);
-        cv::Mat output = net.forward();
+    const int numVariants = useTTA ? static_cast<int>(augmentations.size()) : 1;
+    if (numVariants == 0) {
+        classifyBatch(faceROIs, false, predictions);
+        return;
+    }
 
-        // Reshape and apply softmax to convert scores into class probabilities
-        cv::Mat scores = output.reshape(1, 1);
-        cv::Mat expScores;
-        cv::exp(scores, expScores);
-        expScores /= cv::sum(expScores)[0];  // Softmax normalization
+    cv::Mat probs;
+    if (useTTA) {
+        buildVariants(faceROIs, augmentations);
+        probs = predictProbabilities(variants, mirrored);
+    } else {
+        probs = predictProbabilities(faceROIs);
+    }
 
-        // Accumulate the class probability vector
-        avgScores += expScores;
+    // Average the probability rows belonging to each face, then rank the classes
+    const float weight = 1.0f / static_cast<float>(numVariants);
+    for (size_t i = 0; i < faceROIs.size(); ++i) {
+        auto& avg = predictions[i].probabilities;
+        avg.fill(0.0f);
+        for (int v = 0; v < numVariants; ++v) {
+            const float* row = probs.ptr<float>(static_cast<int>(i) * numVariants + v);
+            for (int c = 0; c < config::NUM_EMOTIONS; ++c) avg[c] += row[c];
+        }
+        for (int c = 0; c < config::NUM_EMOTIONS; ++c) avg[c] *= weight;
+        rankClasses(predictions[i]);
     }
+}
 
-    // Average the scores over the number of variants
-    avgScores /= static_cast<float>(variants.size());
+// Classify preprocessed tensors: copy each chunk into the input tensor and run it
+void EmotionClassifier::classifyTensors(const float* tensors, int count, std::vector<EmotionPrediction>& predictions) {
+    predictions.resize(static_cast<size_t>(count));
+    const size_t tensorSize = static_cast<size_t>(inputSize.area());
+
+    for (int start = 0; start < count; start += maxBatchSize) {
+        const int chunk = std::min(maxBatchSize, count - start);
+        cv::Mat& blob = blobView(chunk);
+        std::memcpy(blob.data, tensors + start * tensorSize, chunk * tensorSize * sizeof(float));
+
+        cv::Mat scores = forward(blob);
+        for (int i = 0; i < chunk; ++i) {
+            EmotionPrediction& prediction = predictions[start + i];
+            softmaxRow(scores.ptr<float>(i), prediction.probabilities.data());
+            rankClasses(prediction);
+        }
+    }
+}
 
-    // Find the index of the class with the highest averaged score
-    cv::Point classIdPoint;
-    double maxVal;
-    cv::minMaxLoc(avgScores, nullptr, &maxVal, nullptr, &classIdPoint);
-    int classId = classIdPoint.x;
+// Adaptive TTA: single pass for every face, variants only for the uncertain ones
+int EmotionClassifier::classifyAdaptive(const std::vector<cv::Mat>& faceROIs, std::vector<EmotionPrediction>& predictions,
+                                        std::vector<uchar>& escalated, const std::vector<uchar>* unstable) {
+    classifyBatch(faceROIs, false, predictions);
+    escalated.assign(faceROIs.size(), 0);
+
+    // The single pass already is the original variant; only the others are rerun
+    extraAugmentations.clear();
+    bool hasOriginal = false;
+    for (const auto& aug : augmentations) {
+        if (!hasOriginal && !aug.flip && aug.angle == 0.0) {
+            hasOriginal = true;
+        } else {
+            extraAugmentations.push_back(aug);
+        }
+    }
+    const int cost = static_cast<int>(extraAugmentations.size());
+    if (cost == 0) {
+        return 0;
+    }
 
-    // Store max confidence score if requested
-    if (confidence) {
-        *confidence = static_cast<float>(maxVal);
+    candidates.clear();
+    for (size_t i = 0; i < predictions.size(); ++i) {
+        if (predictions[i].confidence < adaptiveConfig.confidenceThreshold ||
+            marginOf(predictions[i]) < adaptiveConfig.marginThreshold) {
+            candidates.push_back(static_cast<int>(i));
+        }
     }
 
-    // Return the label corresponding to the predicted class, or "Uncertain" if low confidence
-    std::string label = (classId >= 0 && classId < labels.size()) ? labels[classId] : "Unknown";
-    std::cout << "TTA " << label << " (" << maxVal << ")" << std::endl;
+    // Unstable tracks first, then the closest calls
+    auto isUnstable = [unstable](int i) { return unstable && (*unstable)[i] != 0; };
+    std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+        if (isUnstable(a) != isUnstable(b)) return isUnstable(a);
+        return marginOf(predictions[a]) < marginOf(predictions[b]);
+    });
+    size_t limit = candidates.size();
+    if (adaptiveConfig.maxExtraForwards >= 0) {
+        limit = std::min(limit, static_cast<size_t>(adaptiveConfig.maxExtraForwards / cost));
+    }
+    if (limit == 0) {
+        return 0;
+    }
 
-    return (maxVal < 0.2) ? "Uncertain" : label;
+    escalatedFaces.clear();
+    for (size_t k = 0; k < limit; ++k) {
+        escalatedFaces.push_back(faceROIs[candidates[k]]);
+    }
+    buildVariants(escalatedFaces, extraAugmentations);
+    cv::Mat probs = predictProbabilities(variants, mirrored);
+
+    // Average with the single-pass probabilities, as full TTA would
+    const float weight = 1.0f / static_cast<float>(cost + (hasOriginal ? 1 : 0));
+    for (size_t k = 0; k < limit; ++k) {
+        EmotionPrediction& prediction = predictions[candidates[k]];
+        auto& avg = prediction.probabilities;
+        if (!hasOriginal) avg.fill(0.0f);
+        for (int v = 0; v < cost; ++v) {
+            const float* row = probs.ptr<float>(static_cast<int>(k) * cost + v);
+            for (int c = 0; c < config::NUM_EMOTIONS; ++c) avg[c] += row[c];
+        }
+        for (int c = 0; c < config::NUM_EMOTIONS; ++c) avg[c] *= weight;
+        rankClasses(prediction);
+        escalated[candidates[k]] = 1;
+    }
+    escalatedFaces.clear();   // Do not keep the caller's images alive
+    return static_cast<int>(limit);
 }
@@ -3,32 +3,171 @@
  * Author: Niloofar Karimi
  * Description: Header file for the EmotionClassifier class.
  *              This class handles emotion prediction using a pre-trained ONNX model.
- *              Includes support for standard classification and test-time augmentation (TTA).
+ *              Includes support for standard classification, batched multi-face
+ *              classification and test-time augmentation (TTA). The model runs on a
+ *              pluggable InferenceEngine (OpenCV DNN or ONNX Runtime).
  */
 
 #pragma once
-#include <opencv2/dnn.hpp>
 #include <opencv2/core.hpp>
+#include <array>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "config.hpp"
+#include "inference_engine.hpp"
+#include "preprocess.hpp"
+
+// A single test-time augmentation: optional horizontal flip followed by a rotation (degrees)
+struct Augmentation {
+    bool flip = false;
+    double angle = 0.0;
+};
+
+// When test-time augmentation is applied
+enum class TtaMode {
+    Off,        // Single forward pass per face
+    On,         // Every face is classified with all variants
+    Adaptive    // Single pass first; only low-confidence faces are escalated to the variants
+};
+
+// Parse "off", "on" or "adaptive" (throws std::invalid_argument otherwise)
+TtaMode parseTtaMode(const std::string& name);
+
+// Name of a TTA mode ("off", "on", "adaptive")
+const char* ttaModeName(TtaMode mode);
+
+// Adaptive TTA settings (defaults come from config.hpp)
+struct AdaptiveTtaConfig {
+    float confidenceThreshold;   // Escalate when the top probability is below this...
+    float marginThreshold;       // ...or when it leads the runner-up by less than this
+    int maxExtraForwards;        // Extra image forwards per call (-1 = unlimited)
+
+    AdaptiveTtaConfig();
+};
+
+// Result for one face: the full class probability vector and its ranking. Class indices
+// follow config::EMOTION_LABELS; text is only produced where needed, with emotionLabel().
+struct EmotionPrediction {
+    int classId = -1;                                        // Most likely class
+    float confidence = 0.0f;                                 // Probability of classId
+    std::array<int, config::PREDICTION_TOP_K> topK{};        // Most likely classes, best first
+    std::array<float, config::NUM_EMOTIONS> probabilities{}; // Softmax output (averaged over TTA variants)
+
+    // Top probability below config::UNCERTAIN_THRESHOLD
+    bool isUncertain() const { return confidence < config::UNCERTAIN_THRESHOLD; }
+};
+
+// Display name of a class index: its label, "Uncertain" for a negative index, "Unknown" if
+// out of range
+const std::string& emotionLabel(int classId);
+
+// Display name of a prediction: its class label, or "Uncertain" below the confidence threshold
+const std::string& emotionLabel(const EmotionPrediction& prediction);
+
 class EmotionClassifier {
 public:
-    // Constructor: load ONNX model
-    EmotionClassifier(const std::string& modelPath);
+    // Constructor: load ONNX model on the engine selected by `engineConfig`
+    EmotionClassifier(const std::string& modelPath, const InferenceEngineConfig& engineConfig = InferenceEngineConfig());
+
+    // Predict one face: probabilities, top class and ranking (with TTA if `useTTA`)
+    EmotionPrediction predict(const cv::Mat& faceROI, bool useTTA = false);
 
-    // Predict emotion from a single face image
+    // Predict emotion from a single face image (label text; "Uncertain" below the threshold)
     std::string classify(const cv::Mat& faceROI);
 
     // Predict emotion with confidence output
     std::string classify(const cv::Mat& faceROI, float* confidence);
 
-    // Predict emotion using test-time augmentation (flip + rotate)
+    // Predict emotion using test-time augmentation (flip + rotate).
+    // All variants are packed into one batch and run in a single forward pass.
     std::string classifyWithTTA(const cv::Mat& faceROI);
     std::string classifyWithTTA(const cv::Mat& faceROI, float* confidence);
 
+    // Predict emotions for several faces at once. Faces are packed into batches of at most
+    // getMaxBatchSize() images (TTA variants included) and each batch runs one forward pass.
+    std::vector<EmotionPrediction> classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA = false);
+
+    // Same, writing into `predictions` (resized to one per face). Every intermediate buffer is
+    // kept by the classifier, so repeated calls with no more faces than before allocate nothing
+    // outside the inference engine.
+    void classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA, std::vector<EmotionPrediction>& predictions);
+
+    // Classify `count` model-ready tensors (H x W floats each, already normalized, e.g. from
+    // an f32 packed dataset) laid out back to back. Preprocessing and TTA are skipped.
+    void classifyTensors(const float* tensors, int count, std::vector<EmotionPrediction>& predictions);
+
+    // Adaptive TTA: classify every face with a single pass, then rerun the remaining variants
+    // on the faces below the adaptive thresholds and average them with the single-pass result
+    // (the same probabilities as full TTA for those faces). Candidates flagged in `unstable`
+    // (optional, one flag per face) go first, then the ones with the smallest margin, until
+    // the extra-forward budget is spent. `escalated` gets one flag per face. Returns the
+    // number of escalated faces.
+    int classifyAdaptive(const std::vector<cv::Mat>& faceROIs, std::vector<EmotionPrediction>& predictions,
+                         std::vector<uchar>& escalated, const std::vector<uchar>* unstable = nullptr);
+
+    // Adaptive TTA thresholds and budget
+    void setAdaptiveTta(const AdaptiveTtaConfig& cfg) { adaptiveConfig = cfg; }
+    const AdaptiveTtaConfig& getAdaptiveTta() const { return adaptiveConfig; }
+
+    // Run the network on zero input at the batch sizes of one face with and without TTA, so
+    // lazy graph setup and buffer allocation happen before the first real request. Also
+    // checks the model's output shape.
+    void warmUp();
+
+    // Replace the set of TTA variants (defaults to original + flip + rotations from config)
+    void setAugmentations(const std::vector<Augmentation>& augs);
+    const std::vector<Augmentation>& getAugmentations() const { return augmentations; }
+
+    // Default TTA variants built from config::TTA_USE_FLIP and config::TTA_ROTATION_ANGLES
+    static std::vector<Augmentation> defaultAugmentations();
+
+    // Quiet mode: classify() and classifyWithTTA() no longer print each prediction
+    // (defaults to config::CLASSIFIER_QUIET)
+    void setQuiet(bool enabled) { quiet = enabled; }
+    bool isQuiet() const { return quiet; }
+
+    // Name of the inference engine in use (e.g. "opencv-dnn", "onnxruntime")
+    std::string getBackendName() const { return engine->name(); }
+
+    // Maximum number of images per forward pass (defaults to config::MAX_BATCH_SIZE)
+    void setMaxBatchSize(int size);
+    int getMaxBatchSize() const { return maxBatchSize; }
+
 private:
-    cv::dnn::Net net;                    // Loaded ONNX model
+    // Run the network on a list of images and return an N x numClasses matrix of probabilities
+    // (a view of probBuffer, valid until the next call). `mirrored` (optional, one flag per
+    // image) flips an image horizontally during preprocessing.
+    cv::Mat predictProbabilities(const std::vector<cv::Mat>& images, const std::vector<uchar>& mirrored = {});
+
+    // Build the variants `augs` of the faces (face-major) into `variants` and
+    // `mirrored`. Pure flips are not materialized: the face itself is used with its mirrored
+    // flag set; rotations are warped into the reused rotatedVariants buffers.
+    void buildVariants(const std::vector<cv::Mat>& faceROIs, const std::vector<Augmentation>& augs);
+
+    // Header of the first `count` slots of inputBlob, created once per count
+    cv::Mat& blobView(int count);
+
+    // Run one forward pass on a filled blob view and check the output shape
+    cv::Mat forward(const cv::Mat& blob);
+
+    std::unique_ptr<InferenceEngine> engine; // Runs the loaded ONNX model
     cv::Size inputSize;                  // Expected input size (width, height)
-    std::vector<std::string> labels;     // Emotion labels
+    std::vector<Augmentation> augmentations; // Variants evaluated by classifyWithTTA
+    int maxBatchSize;                    // Upper bound on images per forward pass
+    cv::Mat inputBlob;                   // Preallocated [maxBatchSize, H, W, 1] input tensor
+    PreprocessScratch scratch;           // Reused buffers for the preprocessing kernel
+    std::vector<cv::Mat> blobViews;      // Cached [count, H, W, 1] views of inputBlob (index = count)
+    cv::Mat probBuffer;                  // Probability rows, grown to the largest request seen
+    std::vector<cv::Mat> singleFace;     // predict()'s one-face request
+    std::vector<EmotionPrediction> singlePrediction;
+    std::vector<cv::Mat> variants;       // TTA variants of the current request
+    std::vector<uchar> mirrored;         // Mirror flag per variant
+    std::vector<cv::Mat> rotatedVariants; // Warp targets for rotated variants, reused across calls
+    AdaptiveTtaConfig adaptiveConfig;    // Escalation thresholds and budget
+    std::vector<Augmentation> extraAugmentations; // Adaptive TTA: variants other than the original
+    std::vector<int> candidates;         // Adaptive TTA: faces eligible for escalation
+    std::vector<cv::Mat> escalatedFaces; // Adaptive TTA: faces rerun with the variants
+    bool quiet;                          // Suppress per-prediction console output
 };
@@ -0,0 +1,180 @@
+/**
+ * emotion_smoother.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the per-track EmotionSmoother: moving average and majority vote
+ *              with hysteresis over a flat track table, and eviction of stale tracks.
+ */
+
+#include "emotion_smoother.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+SmoothingMode parseSmoothingMode(const std::string& name) {
+    if (name == "off" || name == "none") return SmoothingMode::Off;
+    if (name == "ema") return SmoothingMode::Ema;
+    if (name == "vote" || name == "majority") return SmoothingMode::MajorityVote;
+    throw std::invalid_argument("Unknown smoothing mode: " + name + " (expected off, ema or vote)");
+}
+
+EmotionSmootherConfig::EmotionSmootherConfig()
+    : mode(parseSmoothingMode(config::SMOOTHING_MODE)),
+      emaAlpha(config::SMOOTHING_EMA_ALPHA),
+      window(config::SMOOTHING_WINDOW),
+      hysteresis(config::SMOOTHING_HYSTERESIS),
+      maxTracks(config::SMOOTHING_MAX_TRACKS),
+      staleFrames(config::SMOOTHING_STALE_FRAMES) {}
+
+// Constructor: validate the settings and allocate the table once
+EmotionSmoother::EmotionSmoother(const EmotionSmootherConfig& cfg) : config(cfg) {
+    if (config.window < 1 || config.window > MAX_WINDOW) {
+        throw std::runtime_error("Smoothing window must be between 1 and " + std::to_string(MAX_WINDOW));
+    }
+    if (config.emaAlpha <= 0.0f || config.emaAlpha > 1.0f) {
+        throw std::runtime_error("Smoothing EMA alpha must be in (0, 1]");
+    }
+    if (config.maxTracks < 1) {
+        throw std::runtime_error("Smoothing needs room for at least one track");
+    }
+
+    // At most half full, so probe chains stay short
+    size_t size = 1;
+    while (size < 2 * static_cast<size_t>(config.maxTracks)) size <<= 1;
+    slots.resize(size);
+}
+
+void EmotionSmoother::reset() {
+    std::fill(slots.begin(), slots.end(), TrackState());
+    liveTracks = 0;
+}
+
+size_t EmotionSmoother::home(int trackId) const {
+    // Fibonacci hashing spreads consecutive IDs over the table
+    return (static_cast<uint32_t>(trackId) * 2654435761u) & (slots.size() - 1);
+}
+
+EmotionSmoother::TrackState& EmotionSmoother::slotFor(int trackId) {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = home(trackId);; i = (i + 1) & mask) {
+        if (slots[i].trackId == trackId) return slots[i];
+        if (slots[i].trackId == EMPTY) {
+            if (liveTracks >= static_cast<size_t>(config.maxTracks)) {
+                // Eviction may move entries; search again
+                evictOldest();
+                return slotFor(trackId);
+            }
+            slots[i] = TrackState();
+            slots[i].trackId = trackId;
+            ++liveTracks;
+            return slots[i];
+        }
+    }
+}
+
+long EmotionSmoother::find(int trackId) const {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = home(trackId); slots[i].trackId != EMPTY; i = (i + 1) & mask) {
+        if (slots[i].trackId == trackId) return static_cast<long>(i);
+    }
+    return -1;
+}
+
+bool EmotionSmoother::isUnstable(int trackId) const {
+    if (config.mode == SmoothingMode::Off || trackId < 0) return false;
+    long index = find(trackId);
+    if (index < 0) return false;
+    const TrackState& state = slots[index];
+    return state.displayed >= 0 && state.voteCounts[state.displayed] < state.voteCount;
+}
+
+void EmotionSmoother::removeAt(size_t index) {
+    // Backward-shift deletion: move later members of the probe chain into the gap so
+    // lookups never stop early at it
+    const size_t mask = slots.size() - 1;
+    size_t gap = index;
+    for (size_t j = (gap + 1) & mask; slots[j].trackId != EMPTY; j = (j + 1) & mask) {
+        size_t k = home(slots[j].trackId);
+        bool reachable = gap <= j ? (gap < k && k <= j) : (gap < k || k <= j);
+        if (reachable) continue;   // Entry j is still found from its home without the gap
+        slots[gap] = slots[j];
+        gap = j;
+    }
+    slots[gap] = TrackState();
+    --liveTracks;
+}
+
+void EmotionSmoother::evictOldest() {
+    size_t oldest = slots.size();
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i].trackId == EMPTY) continue;
+        if (oldest == slots.size() || slots[i].lastSeen < slots[oldest].lastSeen) oldest = i;
+    }
+    if (oldest < slots.size()) removeAt(oldest);
+}
+
+void EmotionSmoother::endFrame() {
+    ++frame;
+    for (size_t i = 0; i < slots.size();) {
+        const TrackState& state = slots[i];
+        if (state.trackId != EMPTY && frame - state.lastSeen > static_cast<uint64_t>(config.staleFrames)) {
+            removeAt(i);   // Slot i may now hold a shifted entry: check it again
+        } else {
+            ++i;
+        }
+    }
+}
+
+SmoothedEmotion EmotionSmoother::update(int trackId, const EmotionPrediction& prediction) {
+    SmoothedEmotion result;
+    if (config.mode == SmoothingMode::Off || trackId < 0) {
+        result.classId = prediction.isUncertain() ? -1 : prediction.classId;
+        result.confidence = prediction.confidence;
+        return result;
+    }
+
+    TrackState& state = slotFor(trackId);
+    const bool first = state.voteCount == 0;
+    state.lastSeen = frame;
+
+    // Moving average of the probabilities (seeded with the first prediction)
+    const float alpha = first ? 1.0f : config.emaAlpha;
+    for (int c = 0; c < config::NUM_EMOTIONS; ++c) {
+        state.average[c] += alpha * (prediction.probabilities[c] - state.average[c]);
+    }
+
+    // Ring of recent classes with running counts
+    const int vote = prediction.isUncertain() ? UNCERTAIN_VOTE : prediction.classId;
+    if (state.voteCount == config.window) {
+        --state.voteCounts[state.votes[state.nextVote]];
+    } else {
+        ++state.voteCount;
+    }
+    state.votes[state.nextVote] = static_cast<uint8_t>(vote);
+    ++state.voteCounts[vote];
+    state.nextVote = (state.nextVote + 1) % config.window;
+
+    // Leading class and the score used for hysteresis
+    int leader = 0;
+    auto score = [&](int c) {
+        return config.mode == SmoothingMode::Ema ? state.average[c]
+                                                 : static_cast<float>(state.voteCounts[c]) / state.voteCount;
+    };
+    const int candidates = config.mode == SmoothingMode::Ema ? config::NUM_EMOTIONS : config::NUM_EMOTIONS + 1;
+    for (int c = 1; c < candidates; ++c) {
+        if (score(c) > score(leader)) leader = c;
+    }
+
+    // Switch only when the leader is clearly ahead of what is displayed
+    if (state.displayed < 0 || (leader != state.displayed && score(leader) >= score(state.displayed) + config.hysteresis)) {
+        state.displayed = leader;
+    }
+
+    if (state.displayed == UNCERTAIN_VOTE) {
+        result.classId = -1;
+        result.confidence = *std::max_element(state.average.begin(), state.average.end());
+    } else {
+        result.confidence = state.average[state.displayed];
+        result.classId = result.confidence < config::UNCERTAIN_THRESHOLD ? -1 : state.displayed;
+    }
+    return result;
+}
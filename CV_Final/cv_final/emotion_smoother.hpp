@@ -0,0 +1,107 @@
+/**
+ * emotion_smoother.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the EmotionSmoother class.
+ *              Smooths each person's predictions over time, keyed by track ID, so faces in
+ *              the same frame no longer share one history. Per-track state (moving average of
+ *              the probabilities, recent classes for a majority vote, displayed class) has a
+ *              fixed size and lives in a flat open-addressing table, so an update costs O(1)
+ *              and memory stays constant. Hysteresis keeps the displayed emotion from
+ *              flickering, and tracks that disappear are evicted.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "emotion_classifier.hpp"
+
+// How predictions are combined over time
+enum class SmoothingMode {
+    Off,            // Pass predictions through
+    Ema,            // Exponential moving average of the probability vectors
+    MajorityVote    // Most frequent class in the last `window` predictions
+};
+
+// Parse "off", "ema" or "vote" (throws std::invalid_argument otherwise)
+SmoothingMode parseSmoothingMode(const std::string& name);
+
+// Smoothing parameters (defaults come from config.hpp)
+struct EmotionSmootherConfig {
+    SmoothingMode mode;
+    float emaAlpha;            // Weight of the newest probabilities
+    int window;                // Majority-vote window (at most EmotionSmoother::MAX_WINDOW)
+    float hysteresis;          // Lead another class needs to replace the displayed one
+    int maxTracks;             // Tracks with state at once (the least recently seen is evicted)
+    int staleFrames;           // Frames a track may go unseen before it is evicted
+
+    EmotionSmootherConfig();
+};
+
+// Smoothed output for one face
+struct SmoothedEmotion {
+    int classId = -1;          // Displayed class (-1 = uncertain)
+    float confidence = 0.0f;   // Averaged probability of the displayed class
+};
+
+class EmotionSmoother {
+public:
+    static const int MAX_WINDOW = 32;
+
+    explicit EmotionSmoother(const EmotionSmootherConfig& config = EmotionSmootherConfig());
+
+    // Add a face's prediction to its track's history and return the smoothed result.
+    // Faces without a track (-1) are passed through unsmoothed.
+    SmoothedEmotion update(int trackId, const EmotionPrediction& prediction);
+
+    // True if the track's recent predictions disagree with the class it displays (tracks
+    // without history, and every track with smoothing off, count as stable)
+    bool isUnstable(int trackId) const;
+
+    // Finish the current frame: tracks not updated for `staleFrames` frames are evicted
+    void endFrame();
+
+    // Forget every track
+    void reset();
+
+    size_t getTrackCount() const { return liveTracks; }
+
+private:
+    static const int EMPTY = -1;
+    static const int UNCERTAIN_VOTE = config::NUM_EMOTIONS;  // Vote slot of uncertain predictions
+
+    // Fixed-size state of one track
+    struct TrackState {
+        int trackId = EMPTY;
+        uint64_t lastSeen = 0;                                  // Frame of the last update
+        std::array<float, config::NUM_EMOTIONS> average{};      // Moving average of the probabilities
+        std::array<uint8_t, MAX_WINDOW> votes{};                // Ring of recent classes
+        std::array<uint8_t, config::NUM_EMOTIONS + 1> voteCounts{}; // Votes per class in the ring
+        int voteCount = 0;
+        int nextVote = 0;
+        int displayed = -1;                                     // Class currently shown
+    };
+
+    // Slot holding `trackId`, creating it if needed
+    TrackState& slotFor(int trackId);
+
+    // Slot index of `trackId`, or -1 if it has no state
+    long find(int trackId) const;
+
+    // Home slot of a track ID in the table
+    size_t home(int trackId) const;
+
+    // Remove the track in slot `index`, shifting later entries of its probe chain back
+    void removeAt(size_t index);
+
+    // Remove the least recently seen track to make room
+    void evictOldest();
+
+    EmotionSmootherConfig config;
+    std::vector<TrackState> slots;   // Open-addressing table (power-of-two size, linear probing)
+    size_t liveTracks = 0;
+    uint64_t frame = 0;
+};
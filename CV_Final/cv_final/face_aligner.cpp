@@ -0,0 +1,132 @@
+/**
+ * face_aligner.cpp
+ * Author: Niloofar Karimi
+ * Description: Implementation of the FaceAligner class and the fused align + crop + resize warp.
+ */
+
+#include "face_aligner.hpp"
+#include "config.hpp"
+#include "assets.hpp"
+#include "utils.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+FaceAlignerConfig::FaceAlignerConfig()
+    : eyeSearchWidth(config::ALIGN_EYE_SEARCH_WIDTH),
+      refreshInterval(config::ALIGN_REFRESH_INTERVAL),
+      poseChangeThreshold(config::ALIGN_POSE_CHANGE_THRESHOLD) {}
+
+// Constructor: load the eye cascade
+FaceAligner::FaceAligner(const std::string& eyeCascadePath, const FaceAlignerConfig& cfg)
+    : config(cfg) {
+    if (!Assets::loadCascade(eyeCascadePath, eyeCascade)) {
+        throw std::runtime_error("Failed to load eye cascade from path: " + eyeCascadePath);
+    }
+}
+
+bool FaceAligner::needsRefresh(const CachedAngle& cached, const cv::Rect& box) const {
+    if (cached.age >= config.refreshInterval) return true;
+
+    // Movement of the center and change of size, relative to the face size at the estimate
+    const float size = static_cast<float>(std::max(cached.box.width, 1));
+    float dx = (box.x + box.width / 2.0f) - (cached.box.x + cached.box.width / 2.0f);
+    float dy = (box.y + box.height / 2.0f) - (cached.box.y + cached.box.height / 2.0f);
+    float moved = std::sqrt(dx * dx + dy * dy) / size;
+    float resized = std::abs(box.width - cached.box.width) / size;
+    return moved > config.poseChangeThreshold || resized > config.poseChangeThreshold;
+}
+
+void FaceAligner::estimateAngles(const cv::Mat& frameGray, const std::vector<cv::Rect>& faces,
+                                 const std::vector<int>& trackIds, std::vector<double>& angles) {
+    estimateAngles(frameGray, faces, trackIds, angles, cache);
+}
+
+void FaceAligner::estimateAngles(const cv::Mat& frameGray, const std::vector<cv::Rect>& faces,
+                                 const std::vector<int>& trackIds, std::vector<double>& angles,
+                                 AngleCache& sourceCache) {
+    auto& entries = sourceCache.entries;
+    auto& seen = sourceCache.seen;
+    angles.assign(faces.size(), 0.0);
+    seen.clear();
+
+    for (size_t i = 0; i < faces.size(); ++i) {
+        int id = i < trackIds.size() ? trackIds[i] : -1;
+        if (id < 0) {
+            estimateAngle(frameGray, faces[i], angles[i]);
+            continue;
+        }
+        seen.push_back(id);
+
+        auto it = entries.find(id);
+        if (it == entries.end() || needsRefresh(it->second, faces[i])) {
+            CachedAngle& cached = entries[id];
+            // A failed search keeps the previous angle (0 for a new track)
+            estimateAngle(frameGray, faces[i], cached.angle);
+            cached.box = faces[i];
+            cached.age = 0;
+            angles[i] = cached.angle;
+        } else {
+            ++it->second.age;
+            angles[i] = it->second.angle;
+        }
+    }
+
+    // Forget tracks that are no longer reported
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (std::find(seen.begin(), seen.end(), it->first) == seen.end()) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool FaceAligner::estimateAngle(const cv::Mat& frameGray, const cv::Rect& face, double& angle) {
+    cv::Rect box = face & cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+    if (box.width < 2 || box.height < 2) return false;
+    ++estimates;
+
+    // Eyes lie in the upper half of the face: search only there, at a fixed small width
+    cv::Rect upperHalf(box.x, box.y, box.width, box.height / 2);
+    const int width = config.eyeSearchWidth;
+    const int height = std::max(1, upperHalf.height * width / upperHalf.width);
+    cv::resize(frameGray(upperHalf), eyeRegion, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+
+    cv::Size minEye(width / 8, width / 8);
+    cv::Size maxEye(width / 2, width / 2);
+    eyeCascade.detectMultiScale(eyeRegion, eyes, 1.1, 2, 0, minEye, maxEye);
+    if (eyes.size() != 2) return false;
+
+    // Center points of both eyes, left to right
+    cv::Point2f eye1(eyes[0].x + eyes[0].width / 2.0f, eyes[0].y + eyes[0].height / 2.0f);
+    cv::Point2f eye2(eyes[1].x + eyes[1].width / 2.0f, eyes[1].y + eyes[1].height / 2.0f);
+    if (eye2.x < eye1.x) std::swap(eye1, eye2);
+
+    // Two hits on the same eye are not a usable pair
+    double dx = eye2.x - eye1.x;
+    double dy = eye2.y - eye1.y;
+    if (dx < std::min(eyes[0].width, eyes[1].width) / 2.0) return false;
+
+    // The search region is scaled uniformly, so the angle needs no conversion
+    angle = std::atan2(dy, dx) * 180.0 / CV_PI;
+    return true;
+}
+
+void alignCrop(const cv::Mat& frameGray, const cv::Rect& face, double angle,
+               const cv::Size& outSize, cv::Mat& out) {
+    // Map the center of the face's square crop to the center of the output (pixel-center
+    // coordinates, as in the INTER_LINEAR half-pixel mapping), rotating and scaling about it
+    const int side = std::min(face.width, face.height);
+    cv::Point2f center(face.x + face.width / 2.0f - 0.5f, face.y + face.height / 2.0f - 0.5f);
+    double scale = static_cast<double>(outSize.width) / side;
+
+    cv::Matx23d transform = Utils::rotationMatrix(center, angle, scale);
+    transform(0, 2) += (outSize.width - 1) / 2.0 - center.x;
+    transform(1, 2) += (outSize.height - 1) / 2.0 - center.y;
+
+    cv::warpAffine(frameGray, out, transform, outSize, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+}
@@ -0,0 +1,83 @@
+/**
+ * face_aligner.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the FaceAligner class.
+ *              Estimates the in-plane rotation of each face from its eyes and produces the
+ *              aligned model input. The eye cascade only searches the upper half of the face,
+ *              normalized to a small fixed width, and the angle of a tracked face is cached and
+ *              re-estimated only periodically or when its box moves or resizes noticeably.
+ *              The rotation is folded into the crop + resize, so each face is warped straight
+ *              to the model's input size instead of rotating the full-size crop first.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Alignment parameters (defaults come from config.hpp)
+struct FaceAlignerConfig {
+    int eyeSearchWidth;        // Faces are resized to this width before the eye search
+    int refreshInterval;       // Re-estimate a tracked face's angle every N frames
+    float poseChangeThreshold; // Re-estimate early when the box moves or resizes by this fraction of its size
+
+    FaceAlignerConfig();
+};
+
+class FaceAligner {
+    struct CachedAngle {
+        double angle = 0.0;
+        cv::Rect box;          // Face box when the angle was estimated
+        int age = 0;           // Frames since the estimate
+    };
+
+public:
+    // Cached angles of one source's tracks. The aligner keeps one for estimateAngles();
+    // callers sharing an aligner between sources keep one per source instead.
+    struct AngleCache {
+        std::unordered_map<int, CachedAngle> entries;   // Track ID -> last estimate
+        std::vector<int> seen;                          // Track IDs of the current frame
+    };
+
+    // Constructor: loads the eye cascade from the given file path
+    FaceAligner(const std::string& eyeCascadePath, const FaceAlignerConfig& config = FaceAlignerConfig());
+
+    // Rotation angle (degrees) for every face of a frame. Faces with a track ID reuse the
+    // cached angle until it is due for a refresh; faces without one (-1) are always estimated.
+    // Cached angles of tracks missing from this frame are dropped. Not thread-safe.
+    void estimateAngles(const cv::Mat& frameGray, const std::vector<cv::Rect>& faces,
+                        const std::vector<int>& trackIds, std::vector<double>& angles);
+
+    // Same, using the caller's cache for the frame's source
+    void estimateAngles(const cv::Mat& frameGray, const std::vector<cv::Rect>& faces,
+                        const std::vector<int>& trackIds, std::vector<double>& angles,
+                        AngleCache& sourceCache);
+
+    // Estimate one face's angle from its eyes. Returns false (and leaves `angle` untouched)
+    // unless exactly two eyes are found side by side.
+    bool estimateAngle(const cv::Mat& frameGray, const cv::Rect& face, double& angle);
+
+    // Number of eye searches run so far (cache misses)
+    uint64_t getEstimateCount() const { return estimates; }
+
+private:
+    // Whether a cached angle must be re-estimated for the face's current box
+    bool needsRefresh(const CachedAngle& cached, const cv::Rect& box) const;
+
+    FaceAlignerConfig config;
+    cv::CascadeClassifier eyeCascade;
+    AngleCache cache;                             // Used when no cache is passed in
+    cv::Mat eyeRegion;                            // Reused normalized upper half of the face
+    std::vector<cv::Rect> eyes;                   // Reused eye detections
+    uint64_t estimates = 0;
+};
+
+// Center-crop `face` to a square, rotate it by `angle` degrees about its center and resize it
+// to `outSize` in a single warp of the full frame (only outSize pixels are computed). With
+// angle 0 the sampling matches preprocessInto()'s crop + bilinear resize. `out` is filled in
+// place when it already has outSize and the frame's type (e.g. a FrameArena buffer).
+void alignCrop(const cv::Mat& frameGray, const cv::Rect& face, double angle,
+               const cv::Size& outSize, cv::Mat& out);
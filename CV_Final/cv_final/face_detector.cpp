@@ -2,16 +2,57 @@
  * face_detector.cpp
  * Author: Niloofar Karimi
  * Description: Implementation of the FaceDetector class.
- *              Uses OpenCV's Haar cascade to detect faces in grayscale images.
+ *              Uses OpenCV's Haar cascade to detect faces in grayscale images. Full-frame
+ *              detection optionally downscales the frame, adapts the searched size range and
+ *              runs tiles in parallel.
  */
 
 #include "face_detector.hpp"
+#include "config.hpp"
+#include "assets.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
 #include <stdexcept>  // For std::runtime_error
 
-// Constructor: Loads the Haar cascade model from the given path.
+// Adaptive sizes: faces needed in the history before the size range is narrowed,
+// and the margin around the recent extremes that is still searched
+static const size_t MIN_ADAPTIVE_SAMPLES = 4;
+static const double ADAPTIVE_MIN_MARGIN = 0.5;
+static const double ADAPTIVE_MAX_MARGIN = 2.0;
+
+// Tiled detection: boxes overlapping more than this (IoU), or mostly contained in one
+// another, are treated as the same face found in two tiles
+static const double MERGE_IOU = 0.3;
+static const double MERGE_CONTAINMENT = 0.7;
+
+// Defaults from config.hpp
+FaceDetectorConfig::FaceDetectorConfig()
+    : scaleFactor(config::DETECT_SCALE_FACTOR),
+      minNeighbors(config::DETECT_MIN_NEIGHBORS),
+      minFaceSize(config::DETECT_MIN_FACE_SIZE),
+      maxDetectWidth(config::DETECT_MAX_WIDTH),
+      adaptiveSizes(config::DETECT_ADAPTIVE_SIZES),
+      adaptiveHistory(config::DETECT_ADAPTIVE_HISTORY),
+      fullScanIntervalMs(config::DETECT_FULL_SCAN_INTERVAL_MS),
+      tileRows(config::DETECT_TILE_ROWS),
+      tileCols(config::DETECT_TILE_COLS) {}
+
+// Constructor: Loads the Haar cascade model from the given path (or built-in asset).
 // Throws an error if loading fails.
-FaceDetector::FaceDetector(const std::string& cascadePath) {
-    if (!faceCascade.load(cascadePath)) {
+FaceDetector::FaceDetector(const std::string& cascadePath, const FaceDetectorConfig& cfg) : config(cfg) {
+    // Tiled detection: one cascade per tile plus one for faces too large for the tiles
+    int numTiles = std::max(1, config.tileRows) * std::max(1, config.tileCols);
+    if (numTiles > 1) {
+        tileCascades.resize(numTiles + 1);
+    }
+
+    // Every copy is built from a single parse of the XML
+    std::vector<cv::CascadeClassifier*> cascades = {&faceCascade};
+    for (auto& cascade : tileCascades) cascades.push_back(&cascade);
+    if (!Assets::loadCascades(cascadePath, cascades)) {
         throw std::runtime_error("Failed to load Haar cascade from path: " + cascadePath);
     }
 }
@@ -24,12 +65,190 @@ FaceDetector::FaceDetector(const std::string& cascadePath) {
 std::vector<cv::Rect> FaceDetector::detect(const cv::Mat& frameGray) {
     std::vector<cv::Rect> faces;
 
+    int minSide, maxSide;
+    sizeRange(minSide, maxSide);
+
+    // Large frames are searched at reduced resolution; boxes are scaled back afterwards
+    double scale = 1.0;
+    const cv::Mat* image = &frameGray;
+    if (config.maxDetectWidth > 0 && frameGray.cols > config.maxDetectWidth) {
+        scale = static_cast<double>(config.maxDetectWidth) / frameGray.cols;
+        cv::resize(frameGray, resized, cv::Size(), scale, scale, cv::INTER_AREA);
+        image = &resized;
+    }
+
+    // Size range in detection-image pixels (the cascade cannot see faces below its window size)
+    int window = faceCascade.getOriginalWindowSize().height;
+    int minScaled = std::max(window, static_cast<int>(std::lround(minSide * scale)));
+    cv::Size minSize(minScaled, minScaled);
+    cv::Size maxSize;
+    if (maxSide > 0) {
+        int maxScaled = std::max(minScaled, static_cast<int>(std::lround(maxSide * scale)));
+        maxSize = cv::Size(maxScaled, maxScaled);
+    }
+
     // Run the Haar cascade classifier to detect faces
-    // scaleFactor = 1.1: image is scaled down by 10% at each scale
-    // minNeighbors = 3: a candidate rectangle needs 3 neighbors to be retained
+    // scaleFactor (default 1.1): image is scaled down by 10% at each scale
+    // minNeighbors (default 3): a candidate rectangle needs 3 neighbors to be retained
     // flags = 0: use default flags
-    // minSize = (30, 30): ignore faces smaller than 30x30 pixels
-    faceCascade.detectMultiScale(frameGray, faces, 1.1, 3, 0, cv::Size(30, 30));
+    if (tileCascades.empty()) {
+        faceCascade.detectMultiScale(*image, faces, config.scaleFactor, config.minNeighbors, 0, minSize, maxSize);
+    } else {
+        faces = detectTiled(*image, minSize, maxSize);
+    }
+
+    if (scale != 1.0) {
+        for (auto& face : faces) {
+            face = cv::Rect(static_cast<int>(std::lround(face.x / scale)), static_cast<int>(std::lround(face.y / scale)),
+                            static_cast<int>(std::lround(face.width / scale)), static_cast<int>(std::lround(face.height / scale)));
+            face &= cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+        }
+    }
+
+    // Remember recent face sizes; an empty narrowed search forces a full-range search next time
+    if (config.adaptiveSizes) {
+        for (const auto& face : faces) {
+            recentSizes.push_back(face.height);
+            if (static_cast<int>(recentSizes.size()) > config.adaptiveHistory) recentSizes.pop_front();
+        }
+        if (faces.empty() && maxSide > 0) {
+            fullScanDue = true;
+        }
+    }
+
+    return faces;
+}
+
+// Size range for a full-frame search: the configured minimum and no maximum, or a band around
+// the recently detected sizes (half the smallest to twice the largest). The full range is still
+// searched every fullScanIntervalMs, timed rather than counted because detection may run only
+// on tracker keyframes, so faces at new distances are picked up within that interval.
+void FaceDetector::sizeRange(int& minSide, int& maxSide) {
+    minSide = config.minFaceSize;
+    maxSide = 0;
+    if (!config.adaptiveSizes) return;
+
+    const auto now = std::chrono::steady_clock::now();
+    const double sinceFullScanMs = std::chrono::duration<double, std::milli>(now - lastFullScan).count();
+    if (recentSizes.size() < MIN_ADAPTIVE_SAMPLES || fullScanDue || sinceFullScanMs >= config.fullScanIntervalMs) {
+        lastFullScan = now;
+        fullScanDue = false;
+        return;
+    }
+
+    auto [smallest, largest] = std::minmax_element(recentSizes.begin(), recentSizes.end());
+    minSide = std::max(config.minFaceSize, static_cast<int>(*smallest * ADAPTIVE_MIN_MARGIN));
+    maxSide = std::max(minSide, static_cast<int>(std::ceil(*largest * ADAPTIVE_MAX_MARGIN)));
+}
+
+// Greedy non-maximum suppression: keep the boxes with the most neighbour hits and drop boxes
+// that overlap or are mostly contained in an already kept one
+static std::vector<cv::Rect> mergeDetections(const std::vector<cv::Rect>& boxes, const std::vector<int>& scores) {
+    std::vector<size_t> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (scores[a] != scores[b]) return scores[a] > scores[b];
+        return boxes[a].area() > boxes[b].area();
+    });
 
+    std::vector<cv::Rect> kept;
+    for (size_t i : order) {
+        const cv::Rect& box = boxes[i];
+        bool duplicate = false;
+        for (const auto& other : kept) {
+            double inter = (box & other).area();
+            if (inter <= 0) continue;
+            double iou = inter / (box.area() + other.area() - inter);
+            double containment = inter / std::min(box.area(), other.area());
+            if (iou > MERGE_IOU || containment > MERGE_CONTAINMENT) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) kept.push_back(box);
+    }
+    return kept;
+}
+
+// detectTiled(): Splits the size range into two bands evaluated in parallel: faces up to the tile
+// overlap are searched in overlapping tiles (every such face lies entirely inside one tile),
+// larger faces on the whole image, where they need only a few coarse pyramid levels.
+std::vector<cv::Rect> FaceDetector::detectTiled(const cv::Mat& image, const cv::Size& minSize, const cv::Size& maxSize) {
+    std::vector<cv::Rect> faces;
+    const int rows = std::max(1, config.tileRows);
+    const int cols = std::max(1, config.tileCols);
+    const int tileW = (image.cols + cols - 1) / cols;
+    const int tileH = (image.rows + rows - 1) / rows;
+
+    int overlap = std::min(tileW, tileH) / 2;
+    if (maxSize.height > 0) overlap = std::min(overlap, maxSize.height);
+
+    // Tiles too small for the smallest face: a single pass is cheaper
+    if (overlap < minSize.height) {
+        faceCascade.detectMultiScale(image, faces, config.scaleFactor, config.minNeighbors, 0, minSize, maxSize);
+        return faces;
+    }
+
+    struct Job {
+        cv::Rect region;
+        cv::Size minSize, maxSize;
+    };
+    std::vector<Job> jobs;
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            cv::Rect tile(c * tileW - overlap / 2, r * tileH - overlap / 2, tileW + overlap, tileH + overlap);
+            jobs.push_back({tile & bounds, minSize, cv::Size(overlap, overlap)});
+        }
+    }
+    if (maxSize.height == 0 || maxSize.height > overlap) {
+        jobs.push_back({bounds, cv::Size(overlap, overlap), maxSize});
+    }
+
+    std::vector<std::vector<cv::Rect>> found(jobs.size());
+    std::vector<std::vector<int>> hits(jobs.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(jobs.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const Job& job = jobs[i];
+            tileCascades[i].detectMultiScale(image(job.region), found[i], hits[i], config.scaleFactor,
+                                             config.minNeighbors, 0, job.minSize, job.maxSize);
+            for (auto& box : found[i]) {
+                box.x += job.region.x;
+                box.y += job.region.y;
+            }
+        }
+    });
+
+    std::vector<cv::Rect> boxes;
+    std::vector<int> scores;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        boxes.insert(boxes.end(), found[i].begin(), found[i].end());
+        scores.insert(scores.end(), hits[i].begin(), hits[i].end());
+    }
+    return mergeDetections(boxes, scores);
+}
+
+// detect(): Detects faces inside a region of the grayscale frame
+// Parameters:
+//   - frameGray: input image in grayscale
+//   - roi: search region (clipped to the frame)
+//   - minSize / maxSize: smallest and largest face size to search for
+// Returns:
+//   - Bounding rectangles in full-frame coordinates
+std::vector<cv::Rect> FaceDetector::detect(const cv::Mat& frameGray, const cv::Rect& roi,
+                                           const cv::Size& minSize, const cv::Size& maxSize) {
+    std::vector<cv::Rect> faces;
+    cv::Rect region = roi & cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+    if (region.width < minSize.width || region.height < minSize.height) {
+        return faces;
+    }
+
+    faceCascade.detectMultiScale(frameGray(region), faces, config.scaleFactor, config.minNeighbors, 0, minSize, maxSize);
+
+    // Shift boxes back to full-frame coordinates
+    for (auto& face : faces) {
+        face.x += region.x;
+        face.y += region.y;
+    }
     return faces;
 }
@@ -4,22 +4,64 @@
  * Description: Header file for the FaceDetector class.
  *              Provides an interface to detect faces in grayscale images using
  *              OpenCV's Haar cascade classifier.
+ *              Full-frame detection can run on a downscaled copy of the frame, restrict the
+ *              searched face sizes to the range seen recently, and split the frame into
+ *              overlapping tiles evaluated in parallel (duplicates merged by NMS).
  */
 
 #pragma once
 #include <opencv2/core.hpp>
 #include <opencv2/objdetect.hpp>
+#include <chrono>
+#include <deque>
+#include <string>
 #include <vector>
 
+// Settings for full-frame detection (defaults come from config.hpp)
+struct FaceDetectorConfig {
+    double scaleFactor;        // Pyramid step of detectMultiScale
+    int minNeighbors;          // Neighbouring hits required to keep a detection
+    int minFaceSize;           // Smallest face searched for, in full-resolution pixels
+    int maxDetectWidth;        // Frames wider than this are downscaled before detection (0 = never)
+    bool adaptiveSizes;        // Narrow the searched size range to recently detected face sizes
+    int adaptiveHistory;       // Number of recent face sizes the adaptive range is derived from
+    double fullScanIntervalMs; // With adaptive sizes, longest time between full size range searches
+    int tileRows, tileCols;    // Tile grid evaluated in parallel (1 x 1 = single pass)
+
+    FaceDetectorConfig();
+};
+
 // Simple face detector using OpenCV's Haar cascades
 class FaceDetector {
 public:
     // Constructor: loads the Haar cascade from the given file path
-    FaceDetector(const std::string& cascadePath);
+    FaceDetector(const std::string& cascadePath, const FaceDetectorConfig& config = FaceDetectorConfig());
 
-    // Detect faces in a grayscale image and return bounding boxes
+    // Detect faces in a grayscale image and return bounding boxes (full-resolution coordinates).
+    // Not thread-safe: updates the adaptive size history.
     std::vector<cv::Rect> detect(const cv::Mat& frameGray);
 
+    // Detect faces only inside `roi`, limited to sizes between minSize and maxSize.
+    // Returned boxes are in full-frame coordinates.
+    std::vector<cv::Rect> detect(const cv::Mat& frameGray, const cv::Rect& roi,
+                                 const cv::Size& minSize, const cv::Size& maxSize);
+
+    // Change the full-frame detection width limit (0 = full resolution)
+    void setMaxDetectWidth(int width) { config.maxDetectWidth = width; }
+    int getMaxDetectWidth() const { return config.maxDetectWidth; }
+
 private:
+    // Face size range (full resolution) for the next full-frame detection
+    void sizeRange(int& minSide, int& maxSide);
+
+    // Run the cascade over overlapping tiles in parallel and merge duplicates
+    std::vector<cv::Rect> detectTiled(const cv::Mat& image, const cv::Size& minSize, const cv::Size& maxSize);
+
+    FaceDetectorConfig config;
     cv::CascadeClassifier faceCascade; // OpenCV face detector
+    std::vector<cv::CascadeClassifier> tileCascades;  // One per tile (cascades are not thread-safe)
+    std::deque<int> recentSizes;       // Heights of recently detected faces (full resolution)
+    std::chrono::steady_clock::time_point lastFullScan;  // Start of the last full-range search
+    bool fullScanDue = true;           // Set when a narrowed search found nothing
+    cv::Mat resized;                   // Reused downscaled frame
 };
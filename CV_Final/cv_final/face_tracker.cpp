@@ -0,0 +1,207 @@
+/**
+ * face_tracker.cpp
+ * Author: Niloofar Karimi
+ * Description: Implementation of the FaceTracker class.
+ *              Keyframes run full-frame Haar detection and associate detections with
+ *              existing tracks by IoU (falling back to centroid distance). Other frames move
+ *              each track with template matching on a downscaled face patch and re-detect
+ *              only inside an expanded region around it.
+ */
+
+#include "face_tracker.hpp"
+#include "config.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+// Width (in pixels) of the downscaled template used for matching between keyframes
+static const int TEMPLATE_WIDTH = 32;
+
+// Tracks whose template match score falls below this are dropped immediately
+static const float LOST_CONFIDENCE = 0.3f;
+
+// Tracks overlapping more than this are considered duplicates of the same face
+static const float DUPLICATE_IOU = 0.7f;
+
+FaceTrackerConfig::FaceTrackerConfig()
+    : detectInterval(config::TRACKER_DETECT_INTERVAL),
+      minConfidence(config::TRACKER_MIN_CONFIDENCE),
+      iouThreshold(config::TRACKER_IOU_THRESHOLD),
+      roiExpansion(config::TRACKER_ROI_EXPANSION),
+      maxMissed(config::TRACKER_MAX_MISSED) {}
+
+// Intersection-over-union of two boxes
+static float iou(const cv::Rect& a, const cv::Rect& b) {
+    int inter = (a & b).area();
+    int uni = a.area() + b.area() - inter;
+    return uni > 0 ? static_cast<float>(inter) / uni : 0.0f;
+}
+
+// Distance between box centers
+static float centroidDistance(const cv::Rect& a, const cv::Rect& b) {
+    float dx = (a.x + a.width * 0.5f) - (b.x + b.width * 0.5f);
+    float dy = (a.y + a.height * 0.5f) - (b.y + b.height * 0.5f);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+FaceTracker::FaceTracker(FaceDetector& det, const FaceTrackerConfig& cfg)
+    : detector(&det), config(cfg), framesSinceKeyframe(cfg.detectInterval) {}
+
+void FaceTracker::reset() {
+    states.clear();
+    tracks.clear();
+    framesSinceKeyframe = config.detectInterval;
+}
+
+// Grow a box by roiExpansion of its size on each side, clipped to the frame
+cv::Rect FaceTracker::expand(const cv::Rect& box, const cv::Mat& frameGray) const {
+    int mx = static_cast<int>(box.width * config.roiExpansion);
+    int my = static_cast<int>(box.height * config.roiExpansion);
+    cv::Rect grown(box.x - mx, box.y - my, box.width + 2 * mx, box.height + 2 * my);
+    return grown & cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+}
+
+void FaceTracker::assign(TrackState& track, const cv::Rect& box, const cv::Mat& frameGray) const {
+    cv::Rect clipped = box & cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+    track.face.box = clipped;
+    track.face.confidence = 1.0f;
+    track.face.missed = 0;
+
+    // Store a downscaled patch so matching stays cheap regardless of face size
+    track.templScale = std::min(1.0, static_cast<double>(TEMPLATE_WIDTH) / std::max(1, clipped.width));
+    cv::resize(frameGray(clipped), track.templ, cv::Size(), track.templScale, track.templScale, cv::INTER_AREA);
+}
+
+float FaceTracker::predict(TrackState& track, const cv::Mat& frameGray) const {
+    if (track.templ.empty()) return 0.0f;
+
+    cv::Rect search = expand(track.face.box, frameGray);
+    cv::Mat searchSmall;
+    cv::resize(frameGray(search), searchSmall, cv::Size(), track.templScale, track.templScale, cv::INTER_AREA);
+    if (searchSmall.cols < track.templ.cols || searchSmall.rows < track.templ.rows) {
+        return 0.0f;  // Face moved out of the frame
+    }
+
+    cv::Mat response;
+    cv::matchTemplate(searchSmall, track.templ, response, cv::TM_CCOEFF_NORMED);
+    double maxVal;
+    cv::Point maxLoc;
+    cv::minMaxLoc(response, nullptr, &maxVal, nullptr, &maxLoc);
+
+    cv::Rect moved(search.x + static_cast<int>(std::lround(maxLoc.x / track.templScale)),
+                   search.y + static_cast<int>(std::lround(maxLoc.y / track.templScale)),
+                   track.face.box.width, track.face.box.height);
+    track.face.box = moved & cv::Rect(0, 0, frameGray.cols, frameGray.rows);
+    return static_cast<float>(std::max(0.0, maxVal));
+}
+
+// Full-frame detection and association of detections with existing tracks
+void FaceTracker::runKeyframe(const cv::Mat& frameGray) {
+    std::vector<cv::Rect> detections = detector->detect(frameGray);
+
+    // Score every (track, detection) pair: IoU when it passes the threshold, otherwise a
+    // lower score for detections whose center is close to the track center
+    std::vector<std::tuple<float, size_t, size_t>> candidates;
+    for (size_t t = 0; t < states.size(); ++t) {
+        const cv::Rect& box = states[t].face.box;
+        for (size_t d = 0; d < detections.size(); ++d) {
+            float overlap = iou(box, detections[d]);
+            if (overlap >= config.iouThreshold) {
+                candidates.emplace_back(overlap, t, d);
+                continue;
+            }
+            float limit = 0.5f * std::min(box.width, detections[d].width);
+            float dist = centroidDistance(box, detections[d]);
+            if (dist < limit) {
+                candidates.emplace_back(config.iouThreshold * (1.0f - dist / limit) * 0.99f, t, d);
+            }
+        }
+    }
+
+    // Greedy assignment, best score first
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    std::vector<bool> trackMatched(states.size(), false);
+    std::vector<bool> detectionMatched(detections.size(), false);
+    for (const auto& [score, t, d] : candidates) {
+        if (trackMatched[t] || detectionMatched[d]) continue;
+        trackMatched[t] = true;
+        detectionMatched[d] = true;
+        assign(states[t], detections[d], frameGray);
+    }
+
+    // Unmatched tracks count a miss and are removed after too many
+    std::vector<TrackState> kept;
+    for (size_t t = 0; t < states.size(); ++t) {
+        if (!trackMatched[t] && ++states[t].face.missed > config.maxMissed) continue;
+        kept.push_back(std::move(states[t]));
+    }
+    states = std::move(kept);
+
+    // Unmatched detections start new tracks
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (detectionMatched[d]) continue;
+        TrackState track;
+        track.face.id = nextId++;
+        assign(track, detections[d], frameGray);
+        states.push_back(std::move(track));
+    }
+}
+
+// Between keyframes: template-match each track, then confirm it with a local detection
+void FaceTracker::runTracking(const cv::Mat& frameGray) {
+    for (auto& track : states) {
+        float score = predict(track, frameGray);
+
+        const cv::Rect& box = track.face.box;
+        cv::Size minSize(static_cast<int>(box.width * 0.7), static_cast<int>(box.height * 0.7));
+        cv::Size maxSize(static_cast<int>(box.width * 1.5), static_cast<int>(box.height * 1.5));
+        std::vector<cv::Rect> local = detector->detect(frameGray, expand(box, frameGray), minSize, maxSize);
+
+        if (local.empty()) {
+            track.face.confidence = score;
+            continue;
+        }
+
+        auto best = std::max_element(local.begin(), local.end(), [&](const cv::Rect& a, const cv::Rect& b) {
+            return iou(a, box) < iou(b, box);
+        });
+        assign(track, *best, frameGray);
+    }
+
+    // Drop lost tracks, and the younger of two tracks that converged on the same face
+    std::vector<TrackState> kept;
+    for (auto& track : states) {
+        if (track.face.confidence < LOST_CONFIDENCE) continue;
+        bool duplicate = std::any_of(kept.begin(), kept.end(), [&](const TrackState& other) {
+            return iou(other.face.box, track.face.box) > DUPLICATE_IOU;
+        });
+        if (!duplicate) kept.push_back(std::move(track));
+    }
+    states = std::move(kept);
+}
+
+const std::vector<TrackedFace>& FaceTracker::update(const cv::Mat& frameGray) {
+    // Full detection on schedule, or as soon as any track becomes unreliable
+    bool lowConfidence = std::any_of(states.begin(), states.end(), [&](const TrackState& track) {
+        return track.face.confidence < config.minConfidence;
+    });
+    keyframe = framesSinceKeyframe >= config.detectInterval || lowConfidence;
+
+    if (keyframe) {
+        runKeyframe(frameGray);
+        framesSinceKeyframe = 0;
+    } else {
+        runTracking(frameGray);
+    }
+    ++framesSinceKeyframe;
+
+    tracks.clear();
+    for (auto& track : states) {
+        ++track.face.age;
+        tracks.push_back(track.face);
+    }
+    return tracks;
+}
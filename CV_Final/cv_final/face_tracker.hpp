@@ -0,0 +1,82 @@
+/**
+ * face_tracker.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the FaceTracker class.
+ *              Adds temporal tracking on top of FaceDetector so the full-frame Haar cascade
+ *              only runs on keyframes. Between keyframes each face is followed with template
+ *              matching and confirmed by a detection restricted to a small region around it.
+ *              Every face keeps a stable track ID for as long as it is tracked.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "face_detector.hpp"
+
+// Tracking parameters (defaults come from config.hpp)
+struct FaceTrackerConfig {
+    int detectInterval;        // Full-frame detection every N frames
+    float minConfidence;       // Force a keyframe when a track falls below this confidence
+    float iouThreshold;        // Minimum IoU for detection/track association
+    float roiExpansion;        // Search margin around a track (fraction of face size per side)
+    int maxMissed;             // Keyframes a track may go undetected before it is removed
+
+    FaceTrackerConfig();
+};
+
+// A tracked face with a stable identifier
+struct TrackedFace {
+    int id = -1;               // Stable track ID (unique for the tracker's lifetime)
+    cv::Rect box;              // Current bounding box in frame coordinates
+    float confidence = 0.0f;   // 1.0 right after detection, match score while tracking
+    int age = 0;               // Frames since the track was created
+    int missed = 0;            // Consecutive keyframes without a matching detection
+};
+
+class FaceTracker {
+public:
+    // Constructor: the detector must outlive the tracker
+    explicit FaceTracker(FaceDetector& detector, const FaceTrackerConfig& config = FaceTrackerConfig());
+
+    // Process the next grayscale frame and return the current tracks
+    const std::vector<TrackedFace>& update(const cv::Mat& frameGray);
+
+    // Drop all tracks (the next update() runs a full detection)
+    void reset();
+
+    // Use another detector from the next update() on (e.g. one borrowed from a shared pool);
+    // it must outlive every update() that uses it
+    void setDetector(FaceDetector& detector) { this->detector = &detector; }
+
+    // Whether the last update() ran full-frame detection
+    bool lastWasKeyframe() const { return keyframe; }
+
+    const std::vector<TrackedFace>& getTracks() const { return tracks; }
+
+private:
+    struct TrackState {
+        TrackedFace face;
+        cv::Mat templ;         // Downscaled appearance used for template matching
+        double templScale = 1.0;
+    };
+
+    void runKeyframe(const cv::Mat& frameGray);
+    void runTracking(const cv::Mat& frameGray);
+
+    // Move a track to its best template match inside the search region; returns the match score
+    float predict(TrackState& track, const cv::Mat& frameGray) const;
+
+    // Re-center a track on a detection and refresh its template
+    void assign(TrackState& track, const cv::Rect& box, const cv::Mat& frameGray) const;
+
+    cv::Rect expand(const cv::Rect& box, const cv::Mat& frameGray) const;
+
+    FaceDetector* detector;
+    FaceTrackerConfig config;
+    std::vector<TrackState> states;
+    std::vector<TrackedFace> tracks;   // Output view of `states`
+    int nextId = 0;
+    int framesSinceKeyframe = 0;
+    bool keyframe = false;
+};
@@ -0,0 +1,61 @@
+/**
+ * frame_arena.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the FrameArena bump allocator.
+ */
+
+#include "frame_arena.hpp"
+
+#include <algorithm>
+
+// Alignment of every buffer (cache line / widest SIMD register)
+static const size_t ARENA_ALIGNMENT = 64;
+
+static size_t alignUp(size_t value) {
+    return (value + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+// First aligned address inside a chunk allocated with ARENA_ALIGNMENT bytes of slack
+static uchar* alignedStart(uchar* chunk) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(chunk);
+    return chunk + (alignUp(address) - address);
+}
+
+FrameArena::FrameArena(size_t initialBytes) {
+    if (initialBytes > 0) {
+        blockSize = alignUp(initialBytes);
+        block.reset(new uchar[blockSize + ARENA_ALIGNMENT]);
+    }
+}
+
+uchar* FrameArena::allocate(size_t bytes) {
+    bytes = alignUp(std::max<size_t>(bytes, 1));
+    frameBytes += bytes;
+
+    if (offset + bytes <= blockSize) {
+        uchar* data = alignedStart(block.get()) + offset;
+        offset += bytes;
+        return data;
+    }
+
+    // Warm-up: serve this request from its own chunk; reset() folds it into the block
+    overflow.emplace_back(new uchar[bytes + ARENA_ALIGNMENT]);
+    return alignedStart(overflow.back().get());
+}
+
+cv::Mat FrameArena::mat(int rows, int cols, int type) {
+    size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+    return cv::Mat(rows, cols, type, allocate(bytes));
+}
+
+void FrameArena::reset() {
+    if (!overflow.empty()) {
+        // Grow to this frame's peak plus headroom, so the next frame fits in one block
+        blockSize = alignUp(frameBytes + frameBytes / 4);
+        block.reset(new uchar[blockSize + ARENA_ALIGNMENT]);
+        overflow.clear();
+        ++growths;
+    }
+    offset = 0;
+    frameBytes = 0;
+}
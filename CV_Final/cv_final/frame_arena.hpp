@@ -0,0 +1,82 @@
+/**
+ * frame_arena.hpp
+ * Author: Niloofar Karimi
+ * Description: Buffer reuse for steady-state frame processing without heap allocations.
+ *              FrameArena is a frame-scoped bump allocator for image buffers: matrices handed
+ *              out during a frame are headers over one preallocated block and are all released
+ *              at once by reset(). The block grows to the peak size seen, so once the pipeline
+ *              has warmed up a frame allocates nothing.
+ *              ObjectPool recycles heap objects (e.g. FrameResult, whose vectors keep their
+ *              capacity) between threads through a lock-free queue.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+class FrameArena {
+public:
+    // Constructor: optionally reserve the block up front
+    explicit FrameArena(size_t initialBytes = 0);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // A rows x cols matrix of `type` in arena memory (64-byte aligned, uninitialized). Valid
+    // until reset(); OpenCV functions writing a result of exactly this size and type fill it
+    // in place.
+    cv::Mat mat(int rows, int cols, int type);
+    cv::Mat mat(const cv::Size& size, int type) { return mat(size.height, size.width, type); }
+
+    // Release every matrix handed out since the last reset(). If the frame did not fit into
+    // the block, the block is replaced by one large enough for it.
+    void reset();
+
+    size_t capacity() const { return blockSize; }
+    size_t used() const { return frameBytes; }
+    uint64_t getGrowths() const { return growths; }   // Times the block had to grow
+
+private:
+    // Aligned storage for `bytes`, from the block or (while warming up) an overflow chunk
+    uchar* allocate(size_t bytes);
+
+    std::unique_ptr<uchar[]> block;                  // Main block (over-allocated for alignment)
+    size_t blockSize = 0;
+    size_t offset = 0;                               // Bump pointer into the block
+    size_t frameBytes = 0;                           // Bytes requested this frame (block + overflow)
+    std::vector<std::unique_ptr<uchar[]>> overflow;  // Chunks used when the block ran out
+    uint64_t growths = 0;
+};
+
+// Recycles objects of type T. acquire() reuses a released object when one is available and
+// creates one otherwise; release() keeps up to `capacity` objects. Thread-safe.
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity) : free(capacity) {}
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    std::unique_ptr<T> acquire() {
+        std::unique_ptr<T> object;
+        if (!free.tryPop(object) || !object) {
+            object = std::make_unique<T>();
+        }
+        return object;
+    }
+
+    // Return an object for reuse (its state is kept; callers reset what they need). Objects
+    // that do not fit are destroyed.
+    void release(std::unique_ptr<T> object) {
+        if (object) free.tryPush(std::move(object));
+    }
+
+private:
+    BoundedQueue<std::unique_ptr<T>> free;
+};
@@ -0,0 +1,460 @@
+/**
+ * frame_source.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the FrameReader class: input type detection, the read-ahead
+ *              decode thread, optional realtime pacing and the luma ingest paths (raw
+ *              capture, Y4M reader).
+ */
+
+#include "frame_source.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+// True if the string is a non-empty run of digits (a camera index)
+static bool isCameraIndex(const std::string& input) {
+    return !input.empty() && std::all_of(input.begin(), input.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+// Image files in a directory, sorted by name
+static std::vector<std::string> listImages(const fs::path& dir) {
+    static const std::set<std::string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".pgm", ".ppm"};
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (extensions.count(ext)) paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// True if the path has the given extension (lowercase, with the dot), ignoring case
+static bool hasExtension(const std::string& path, const std::string& extension) {
+    std::string ext = fs::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == extension;
+}
+
+// Widen a view of the top rows of a buffer (a Y plane cut from a YUV frame) back to the whole
+// buffer, so the next frame can be decoded into it without reallocating
+static void restoreFullBuffer(cv::Mat& frame) {
+    if (frame.empty()) return;
+    cv::Size whole;
+    cv::Point offset;
+    frame.locateROI(whole, offset);
+    frame.adjustROI(offset.y, whole.height - offset.y - frame.rows, offset.x, whole.width - offset.x - frame.cols);
+}
+
+// Shape `frame` as the Y plane of `size` with the rows below it holding a raw frame of
+// `rawChannels` bytes per pixel, reusing the buffer when it already has that shape.
+// Returns the raw frame area.
+static cv::Mat splitLumaBuffer(cv::Mat& frame, const cv::Size& size, int rawChannels) {
+    restoreFullBuffer(frame);
+    const int rows = size.height * (1 + rawChannels);
+    if (frame.rows != rows || frame.cols != size.width || frame.type() != CV_8UC1 || !frame.isContinuous()) {
+        frame.create(rows, size.width, CV_8UC1);
+    }
+    cv::Mat raw = frame.rowRange(size.height, rows).reshape(rawChannels, size.height);
+    frame = frame.rowRange(0, size.height);
+    return raw;
+}
+
+// Constructor: open the camera, video, sequence pattern or directory
+FrameReader::FrameReader(const FrameSourceConfig& cfg)
+    : config(cfg), readAheadQueue(std::max<size_t>(cfg.readAhead, 2)),
+      recycleQueue(std::max<size_t>(cfg.readAhead, 2) + 2) {
+
+    if (isCameraIndex(config.input)) {
+        live = true;
+        capture.open(std::stoi(config.input));
+        if (!capture.isOpened()) {
+            throw std::runtime_error("Could not open camera " + config.input);
+        }
+    } else if (fs::is_directory(config.input)) {
+        imagePaths = listImages(config.input);
+        if (imagePaths.empty()) {
+            throw std::runtime_error("No images found in directory: " + config.input);
+        }
+        // Images are decoded to color anyway when color is kept, so they stay BGR then
+        if (config.luma && !config.keepColor) ingest.store("gray-decode");
+    } else if (config.luma && hasExtension(config.input, ".y4m")) {
+        openY4m();
+    } else {
+        // Video files and printf-style image sequence patterns
+        capture.open(config.input);
+        if (!capture.isOpened()) {
+            throw std::runtime_error("Could not open video source: " + config.input);
+        }
+    }
+
+    if (capture.isOpened()) {
+        fps = capture.get(cv::CAP_PROP_FPS);
+        if (config.luma) {
+            // Ask for frames as the source stores them; backends that cannot, still decode to BGR
+            capture.set(cv::CAP_PROP_CONVERT_RGB, 0);
+            frameSize = cv::Size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                 static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+            const int fourcc = static_cast<int>(capture.get(cv::CAP_PROP_FOURCC));
+            if (fourcc == cv::VideoWriter::fourcc('U', 'Y', 'V', 'Y') ||
+                fourcc == cv::VideoWriter::fourcc('Y', '4', '2', '2')) {
+                packedLumaChannel = 1;
+            }
+            if (fourcc == cv::VideoWriter::fourcc('N', 'V', '1', '2')) {
+                yuv420ToBgr = cv::COLOR_YUV2BGR_NV12;
+            } else if (fourcc == cv::VideoWriter::fourcc('N', 'V', '2', '1')) {
+                yuv420ToBgr = cv::COLOR_YUV2BGR_NV21;
+            } else if (fourcc == cv::VideoWriter::fourcc('Y', 'V', '1', '2')) {
+                yuv420ToBgr = cv::COLOR_YUV2BGR_YV12;
+            } else {
+                yuv420ToBgr = cv::COLOR_YUV2BGR_I420;
+            }
+        }
+    }
+    if (fps <= 0.0) fps = config.sequenceFps;
+
+    // Cameras are read directly by the caller's capture thread unless only the newest frame
+    // is wanted; files decode ahead
+    if (!live) {
+        decoder = std::thread(&FrameReader::decodeLoop, this);
+    } else if (config.latestOnly) {
+        decoder = std::thread(&FrameReader::grabLoop, this);
+    }
+}
+
+bool FrameReader::isCameraInput(const std::string& input) {
+    return isCameraIndex(input);
+}
+
+FrameReader::~FrameReader() {
+    close();
+}
+
+void FrameReader::close() {
+    running.store(false);
+    latestReady.notify_all();
+    if (decoder.joinable()) decoder.join();
+    capture.release();
+    y4m.close();
+}
+
+// Parse the stream header of a Y4M file: frame size, rate and chroma layout
+void FrameReader::openY4m() {
+    y4m.open(config.input, std::ios::binary);
+    std::string header;
+    if (!y4m || !std::getline(y4m, header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        throw std::runtime_error("Not a Y4M file: " + config.input);
+    }
+
+    std::istringstream fields(header.substr(10));
+    std::string field;
+    std::string colorspace = "420";
+    while (fields >> field) {
+        switch (field[0]) {
+            case 'W': frameSize.width = std::atoi(field.c_str() + 1); break;
+            case 'H': frameSize.height = std::atoi(field.c_str() + 1); break;
+            case 'C': colorspace = field.substr(1); break;
+            case 'F': {
+                int num = 0, den = 0;
+                if (std::sscanf(field.c_str() + 1, "%d:%d", &num, &den) == 2 && num > 0 && den > 0) {
+                    fps = static_cast<double>(num) / den;
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+    if (frameSize.width <= 0 || frameSize.height <= 0) {
+        throw std::runtime_error("Y4M header without a frame size: " + config.input);
+    }
+
+    // 8-bit layouts only; chroma planes are skipped unless color is kept, so their size matters.
+    // High bit depth tags end in "p<bits>" (420p10, 422p12, 444p16)
+    const size_t depth = colorspace.find('p');
+    if (depth != std::string::npos && depth + 1 < colorspace.size() &&
+        std::isdigit(static_cast<unsigned char>(colorspace[depth + 1]))) {
+        throw std::runtime_error("Unsupported Y4M bit depth C" + colorspace + " (8-bit only): " + config.input);
+    }
+    // 420jpeg, 420paldv and 420mpeg2 differ only in chroma siting
+    if (colorspace == "420" || colorspace == "420jpeg" || colorspace == "420paldv" || colorspace == "420mpeg2") {
+        y4mChromaSize = cv::Size((frameSize.width + 1) / 2, (frameSize.height + 1) / 2);
+    } else if (colorspace == "422") {
+        y4mChromaSize = cv::Size((frameSize.width + 1) / 2, frameSize.height);
+    } else if (colorspace == "411") {
+        y4mChromaSize = cv::Size((frameSize.width + 3) / 4, frameSize.height);
+    } else if (colorspace == "444") {
+        y4mChromaSize = frameSize;
+    } else if (colorspace == "mono") {
+        y4mChromaSize = cv::Size();
+    } else {
+        throw std::runtime_error("Unsupported Y4M colorspace C" + colorspace + ": " + config.input);
+    }
+    y4mChromaBytes = 2 * static_cast<size_t>(y4mChromaSize.area());
+
+    // Even-sized 4:2:0 is I420 as cvtColor expects it; other layouts are upsampled by toBgr()
+    if (y4mChromaBytes == 0) {
+        colorLayout.store(static_cast<int>(ColorLayout::Gray));
+    } else if (y4mChromaSize.width * 2 == frameSize.width && y4mChromaSize.height * 2 == frameSize.height) {
+        colorLayout.store(static_cast<int>(ColorLayout::Yuv420));
+        colorCode.store(cv::COLOR_YUV2BGR_I420);
+    } else {
+        colorLayout.store(static_cast<int>(ColorLayout::Y4mPlanes));
+    }
+    ingest.store("y4m");
+}
+
+// Read the next Y4M frame's Y plane; a truncated last frame ends the stream
+bool FrameReader::readY4m(cv::Mat& frame) {
+    std::string marker;
+    if (!std::getline(y4m, marker)) return false;
+    if (marker.compare(0, 5, "FRAME") != 0) {
+        throw std::runtime_error("Corrupt Y4M frame header in " + config.input);
+    }
+    restoreFullBuffer(frame);
+    if (!config.keepColor || y4mChromaBytes == 0) {
+        frame.create(frameSize, CV_8UC1);
+        y4m.read(reinterpret_cast<char*>(frame.data), static_cast<std::streamsize>(frame.total()));
+        y4m.seekg(static_cast<std::streamoff>(y4mChromaBytes), std::ios::cur);
+        return static_cast<bool>(y4m);
+    }
+
+    // Keep the chroma planes in the rows below the Y plane, in file order
+    const size_t lumaBytes = static_cast<size_t>(frameSize.area());
+    const int chromaRows = static_cast<int>((y4mChromaBytes + frameSize.width - 1) / frameSize.width);
+    frame.create(frameSize.height + chromaRows, frameSize.width, CV_8UC1);
+    y4m.read(reinterpret_cast<char*>(frame.data), static_cast<std::streamsize>(lumaBytes + y4mChromaBytes));
+    frame = frame.rowRange(0, frameSize.height);
+    return static_cast<bool>(y4m);
+}
+
+// Read a camera or video frame as its Y plane
+bool FrameReader::readLuma(cv::Mat& frame) {
+    if (planarRaw) {
+        // Decode into the whole buffer the previous Y plane was cut from
+        restoreFullBuffer(frame);
+        if (!capture.read(frame) || frame.empty()) return false;
+
+        // Gray or planar YUV (NV12, I420, ...): the Y plane is the top rows, used in place
+        if (frame.type() == CV_8UC1 && (frameSize.empty() || (frame.cols == frameSize.width &&
+                                                               frame.rows >= frameSize.height))) {
+            // 4:2:0 chroma stays in the buffer below the Y plane view
+            const bool yuv420 = !frameSize.empty() && frameSize.height % 2 == 0 &&
+                                frame.rows == frameSize.height * 3 / 2;
+            colorLayout.store(static_cast<int>(yuv420 ? ColorLayout::Yuv420 : ColorLayout::Gray));
+            colorCode.store(yuv420ToBgr);
+            if (!frameSize.empty() && frame.rows > frameSize.height) {
+                frame = frame.rowRange(0, frameSize.height);
+            }
+            ingest.store("y-plane");
+            return true;
+        }
+
+        // Anything else is gathered into the caller's buffer from now on
+        planarRaw = false;
+        rawFrame = frame;
+        frame = cv::Mat();
+    } else if (!capture.read(rawFrame) || rawFrame.empty()) {
+        return false;
+    }
+    return lumaFromRaw(frame);
+}
+
+// Gray frame from a non-planar raw frame (rawFrame). With keepColor the raw frame is copied
+// below the Y plane, which is then written in place.
+bool FrameReader::lumaFromRaw(cv::Mat& frame) {
+    const int type = rawFrame.type();
+    if (config.keepColor && (type == CV_8UC2 || type == CV_8UC3 || type == CV_8UC4)) {
+        cv::Mat raw = splitLumaBuffer(frame, rawFrame.size(), rawFrame.channels());
+        rawFrame.copyTo(raw);
+        colorLayout.store(static_cast<int>(ColorLayout::RawBelow));
+    }
+    switch (type) {
+        case CV_8UC2:
+            // Packed 4:2:2 (YUYV, UYVY): every other byte is Y
+            cv::extractChannel(rawFrame, frame, packedLumaChannel);
+            colorCode.store(packedLumaChannel == 1 ? cv::COLOR_YUV2BGR_UYVY : cv::COLOR_YUV2BGR_YUY2);
+            ingest.store("packed-yuv");
+            return true;
+        case CV_8UC3:
+            cv::cvtColor(rawFrame, frame, cv::COLOR_BGR2GRAY);
+            colorCode.store(-1);   // Already BGR
+            ingest.store("bgr-to-gray");
+            return true;
+        case CV_8UC4:
+            cv::cvtColor(rawFrame, frame, cv::COLOR_BGRA2GRAY);
+            colorCode.store(cv::COLOR_BGRA2BGR);
+            ingest.store("bgr-to-gray");
+            return true;
+        default:
+            break;
+    }
+    if (convertRgbRestored) {
+        throw std::runtime_error("Unsupported raw frame format from " + config.input);
+    }
+
+    // Compressed camera formats (MJPEG) arrive undecoded: let the backend decode them after all
+    convertRgbRestored = true;
+    capture.set(cv::CAP_PROP_CONVERT_RGB, 1);
+    if (!capture.read(rawFrame) || rawFrame.empty()) return false;
+    return lumaFromRaw(frame);
+}
+
+cv::Mat& FrameReader::toBgr(cv::Mat& frame, cv::Mat& scratch) const {
+    if (frame.channels() != 1) return frame;
+
+    // The whole buffer the Y plane view was cut from; its rows below the view hold the color
+    cv::Size whole;
+    cv::Point offset;
+    frame.locateROI(whole, offset);
+    const int h = frame.rows;
+    const int w = frame.cols;
+    cv::Mat full = frame;
+    if (offset.x == 0 && offset.y == 0 && whole.width == w) full.adjustROI(0, whole.height - h, 0, 0);
+
+    const int code = colorCode.load();
+    switch (static_cast<ColorLayout>(colorLayout.load())) {
+        case ColorLayout::Yuv420:
+            if (full.rows < h + h / 2) break;
+            cv::cvtColor(full.rowRange(0, h + h / 2), scratch, code);
+            return scratch;
+        case ColorLayout::RawBelow: {
+            const int channels = full.rows / h - 1;
+            if (full.rows % h != 0 || channels < 2 || channels > 4) break;
+            cv::Mat raw = full.rowRange(h, full.rows).reshape(channels, h);
+            if (code < 0) {
+                raw.copyTo(scratch);
+            } else {
+                cv::cvtColor(raw, scratch, code);
+            }
+            return scratch;
+        }
+        case ColorLayout::Y4mPlanes: {
+            const size_t planeBytes = static_cast<size_t>(y4mChromaSize.area());
+            if (full.total() < frame.total() + 2 * planeBytes) break;
+            // Upsample the chroma planes to full resolution and convert Y'CbCr to BGR
+            uchar* chroma = full.ptr(h);
+            std::vector<cv::Mat> planes(3);
+            planes[0] = frame;
+            cv::resize(cv::Mat(y4mChromaSize, CV_8UC1, chroma), planes[1], frame.size(), 0, 0, cv::INTER_LINEAR);
+            cv::resize(cv::Mat(y4mChromaSize, CV_8UC1, chroma + planeBytes), planes[2], frame.size(), 0, 0,
+                       cv::INTER_LINEAR);
+            cv::merge(planes, scratch);
+            cv::cvtColor(scratch, scratch, cv::COLOR_YUV2BGR);
+            return scratch;
+        }
+        case ColorLayout::Gray:
+            break;
+    }
+    cv::cvtColor(frame, scratch, cv::COLOR_GRAY2BGR);
+    return scratch;
+}
+
+// Decode one frame from the underlying source
+bool FrameReader::decodeNext(cv::Mat& frame) {
+    if (!imagePaths.empty()) {
+        // Skip unreadable files rather than ending the sequence
+        while (nextImage < imagePaths.size()) {
+            const bool gray = config.luma && !config.keepColor;
+            frame = cv::imread(imagePaths[nextImage++], gray ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+            if (!frame.empty()) return true;
+        }
+        return false;
+    }
+    if (y4m.is_open()) return readY4m(frame);
+    if (config.luma) return readLuma(frame);
+    return capture.read(frame) && !frame.empty();
+}
+
+// Decode thread: keep the read-ahead buffer full, waiting (never dropping) when it is
+void FrameReader::decodeLoop() {
+    while (running.load()) {
+        // Decode into a returned buffer when one is available (same-size video frames are
+        // then written in place); image files are always decoded into new buffers
+        cv::Mat frame;
+        recycleQueue.tryPop(frame);
+        if (!decodeNext(frame)) break;
+
+        while (!readAheadQueue.tryPush(std::move(frame))) {
+            if (!running.load()) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    decodeDone.store(true);
+}
+
+// Grab thread (latestOnly cameras): keep replacing the slot with the newest frame, so the
+// driver's queue never fills up and a slow consumer never sees a stale frame
+void FrameReader::grabLoop() {
+    cv::Mat frame;
+    while (running.load()) {
+        // Decode into the buffer the slot gave up, unless the consumer still shares it
+        if (frame.u && frame.u->refcount > 1) frame.release();
+        if (!decodeNext(frame)) break;
+        {
+            std::lock_guard<std::mutex> lock(latestMutex);
+            if (latestFresh) framesDiscarded.fetch_add(1);
+            std::swap(latest, frame);
+            latestFresh = true;
+        }
+        latestReady.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(latestMutex);
+        decodeDone.store(true);
+    }
+    latestReady.notify_all();
+}
+
+bool FrameReader::read(cv::Mat& frame) {
+    if (live && config.latestOnly) {
+        // Wait for a frame newer than the last one handed out, then trade buffers with the slot
+        std::unique_lock<std::mutex> lock(latestMutex);
+        latestReady.wait(lock, [this]() { return latestFresh || decodeDone.load() || !running.load(); });
+        if (!latestFresh) return false;
+        std::swap(frame, latest);
+        latestFresh = false;
+        ++framesRead;
+        return true;
+    }
+    if (live) {
+        if (!running.load() || !decodeNext(frame)) return false;
+        ++framesRead;
+        return true;
+    }
+
+    // Hand the caller's previous frame back to the decoder unless it is still shared
+    if (frame.u && frame.u->refcount == 1 && frame.data == frame.datastart && frame.isContinuous()) {
+        recycleQueue.tryPush(std::move(frame));
+    }
+
+    // Wait for the decoder; check decodeDone before popping so the last frames are not lost
+    while (true) {
+        bool done = decodeDone.load();
+        if (readAheadQueue.tryPop(frame)) break;
+        if (done || !running.load()) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    // Realtime pacing: hold each frame until its presentation time
+    if (config.realtimePacing) {
+        auto now = std::chrono::steady_clock::now();
+        if (framesRead == 0) paceStart = now;
+        auto due = paceStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(framesRead / fps));
+        if (due > now) std::this_thread::sleep_until(due);
+    }
+
+    ++framesRead;
+    return true;
+}
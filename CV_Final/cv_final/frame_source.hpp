@@ -0,0 +1,139 @@
+/**
+ * frame_source.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the FrameReader class.
+ *              Reads frames from a webcam, a video file, an image sequence pattern
+ *              (e.g. "frames/img_%04d.png") or a directory of images. File sources are
+ *              decoded on a dedicated thread into a read-ahead buffer, and can either be
+ *              delivered as fast as the consumer takes them or paced at the source frame rate.
+ *              Frame buffers handed back through read() are reused by the decoder, so a
+ *              steady video stream is decoded without per-frame allocations.
+ *              Cameras are read on the caller's thread, or with latestOnly grabbed continuously
+ *              into a single slot so a consumer slower than the camera always gets the newest
+ *              frame instead of one queued in the driver.
+ *              With luma ingest, frames are the CV_8UC1 Y (brightness) plane instead of BGR:
+ *              cameras and videos are read without color conversion (CAP_PROP_CONVERT_RGB off)
+ *              and planar YUV frames are cut down to their Y rows in place, Y4M files are read
+ *              plane by plane, skipping chroma, and images are decoded straight to gray.
+ *              With keepColor the chroma stays in the frame's buffer, below the Y plane view
+ *              (planar YUV as decoded, packed YUV or BGR copied there), and toBgr() rebuilds
+ *              color only for the frames that are actually shown or recorded.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+// Settings for a FrameReader
+struct FrameSourceConfig {
+    std::string input = "0";     // Camera index, video file, image sequence pattern or directory
+    bool realtimePacing = false; // Deliver file frames at the source frame rate instead of ASAP
+    size_t readAhead = 8;        // Decoded frames buffered ahead of the consumer (file sources)
+    double sequenceFps = 30.0;   // Frame rate assumed for image directories and when unknown
+    bool luma = false;           // Deliver the Y plane (CV_8UC1) instead of BGR frames
+    bool latestOnly = false;     // Cameras: grab continuously and deliver only the newest frame
+    bool keepColor = false;      // Luma ingest: keep each frame's chroma for toBgr()
+};
+
+class FrameReader {
+public:
+    // Constructor: open the input and, for file sources, start the decode thread
+    explicit FrameReader(const FrameSourceConfig& config);
+    ~FrameReader();
+
+    FrameReader(const FrameReader&) = delete;
+    FrameReader& operator=(const FrameReader&) = delete;
+
+    // Next frame; returns false once the source is exhausted or closed. If `frame` holds the
+    // only reference to an earlier frame's buffer, that buffer is recycled for decoding.
+    bool read(cv::Mat& frame);
+
+    // Stop decoding and release the input
+    void close();
+
+    // True for cameras: frames arrive in real time and may be dropped downstream
+    bool isLive() const { return live; }
+
+    // Whether `input` names a camera (what isLive() will report), without opening it
+    static bool isCameraInput(const std::string& input);
+
+    // Source frame rate (camera/video metadata, or config.sequenceFps)
+    double getFps() const { return fps; }
+
+    // Frames handed out by read()
+    uint64_t getFramesRead() const { return framesRead; }
+
+    // Camera frames replaced by a newer one before read() took them (latestOnly)
+    uint64_t getFramesDiscarded() const { return framesDiscarded.load(); }
+
+    // BGR version of a frame from read(): `frame` itself when it is BGR, otherwise converted
+    // into `scratch` from the chroma kept with it (keepColor), or expanded from gray.
+    // May be called on another thread than read().
+    cv::Mat& toBgr(cv::Mat& frame, cv::Mat& scratch) const;
+
+    // How frames are produced: "bgr", and with luma ingest "y-plane" (no conversion), "y4m",
+    // "packed-yuv" (Y bytes gathered), "gray-decode" (images) or "bgr-to-gray" (the backend
+    // only delivers BGR). Cameras and videos report the luma path once a frame has been read.
+    const char* getIngestName() const { return ingest.load(); }
+
+private:
+    void decodeLoop();
+    void grabLoop();
+    bool decodeNext(cv::Mat& frame);
+    void openY4m();
+    bool readY4m(cv::Mat& frame);
+    bool readLuma(cv::Mat& frame);
+    bool lumaFromRaw(cv::Mat& frame);
+
+    FrameSourceConfig config;
+    bool live = false;
+    double fps = 0.0;
+    uint64_t framesRead = 0;
+
+    cv::VideoCapture capture;              // Camera, video file or sequence pattern
+    std::vector<std::string> imagePaths;   // Directory input, sorted by file name
+    size_t nextImage = 0;
+
+    // Luma ingest
+    std::ifstream y4m;                     // Y4M input, read directly
+    size_t y4mChromaBytes = 0;             // Chroma planes skipped after every Y plane
+    cv::Size frameSize;                    // Frame size reported by the source (empty if unknown)
+    bool planarRaw = true;                 // Raw frames are planar (Y rows first) until one is not
+    bool convertRgbRestored = false;       // Backend decodes to BGR after all (compressed cameras)
+    int packedLumaChannel = 0;             // Y byte of packed 4:2:2 pixels (1 for UYVY)
+    int yuv420ToBgr = 0;                   // cvtColor code for the source's 4:2:0 layout
+    cv::Size y4mChromaSize;                // Size of each Y4M chroma plane
+
+    // Where a luma frame's color is (keepColor), with the cvtColor code that restores it
+    enum class ColorLayout { Gray, Yuv420, RawBelow, Y4mPlanes };
+    std::atomic<int> colorLayout{static_cast<int>(ColorLayout::Gray)};
+    std::atomic<int> colorCode{-1};
+    cv::Mat rawFrame;                      // Non-planar raw frame the Y plane is gathered from
+    std::atomic<const char*> ingest{"bgr"};
+
+    BoundedQueue<cv::Mat> readAheadQueue;  // decode thread → read()
+    BoundedQueue<cv::Mat> recycleQueue;    // read() → decode thread: frame buffers to decode into
+    std::atomic<bool> running{true};
+    std::atomic<bool> decodeDone{false};
+    std::thread decoder;
+
+    // Latest-frame slot (latestOnly cameras): grab thread → read()
+    std::mutex latestMutex;
+    std::condition_variable latestReady;
+    cv::Mat latest;
+    bool latestFresh = false;              // `latest` has not been handed out yet
+    std::atomic<uint64_t> framesDiscarded{0};
+
+    std::chrono::steady_clock::time_point paceStart;
+};
@@ -0,0 +1,195 @@
+/**
+ * inference_batcher.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the InferenceBatcher request queue, its deadline-driven dispatcher
+ *              thread and the batch-size / queueing-delay statistics.
+ */
+
+#include "inference_batcher.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+// Queueing delays kept for percentile statistics
+static const size_t DELAY_HISTORY = 4096;
+
+InferenceBatcherConfig::InferenceBatcherConfig()
+    : maxBatchSize(config::MAX_BATCH_SIZE),
+      maxDelayMs(config::BATCHER_MAX_DELAY_MS) {}
+
+// Constructor: load the model and start the dispatcher
+InferenceBatcher::InferenceBatcher(const std::string& modelPath, const InferenceEngineConfig& engineConfig,
+                                   const InferenceBatcherConfig& cfg)
+    : config(cfg), classifier(modelPath, engineConfig) {
+    if (config.maxBatchSize < 1) {
+        throw std::runtime_error("InferenceBatcher needs a max batch size of at least 1");
+    }
+    classifier.setMaxBatchSize(config.maxBatchSize);
+    classifier.setQuiet(true);
+    batchSizeCounts.assign(static_cast<size_t>(config.maxBatchSize) + 1, 0);
+    recentDelaysMs.reserve(DELAY_HISTORY);
+
+    dispatcher = std::thread(&InferenceBatcher::dispatchLoop, this);
+}
+
+InferenceBatcher::~InferenceBatcher() {
+    stop();
+}
+
+void InferenceBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    if (dispatcher.joinable()) dispatcher.join();
+}
+
+std::future<EmotionPrediction> InferenceBatcher::submit(const cv::Mat& faceROI, bool useTTA) {
+    Request request;
+    request.face = faceROI;
+    request.useTTA = useTTA;
+    std::future<EmotionPrediction> future = request.result.get_future();
+
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            throw std::runtime_error("InferenceBatcher is stopped");
+        }
+        request.submitted = Clock::now();
+        queue.push_back(std::move(request));
+        // The dispatcher waits either for a first request or for a full batch
+        notify = queue.size() == 1 || queue.size() >= static_cast<size_t>(config.maxBatchSize);
+    }
+    if (notify) wake.notify_one();
+    return future;
+}
+
+std::vector<EmotionPrediction> InferenceBatcher::classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA) {
+    std::vector<std::future<EmotionPrediction>> futures;
+    futures.reserve(faceROIs.size());
+    {
+        // Queue all faces under one lock so they can share a batch
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            throw std::runtime_error("InferenceBatcher is stopped");
+        }
+        Clock::time_point now = Clock::now();
+        for (const auto& face : faceROIs) {
+            Request request;
+            request.face = face;
+            request.useTTA = useTTA;
+            request.submitted = now;
+            futures.push_back(request.result.get_future());
+            queue.push_back(std::move(request));
+        }
+    }
+    if (!faceROIs.empty()) wake.notify_one();
+
+    std::vector<EmotionPrediction> predictions;
+    predictions.reserve(futures.size());
+    for (auto& future : futures) {
+        predictions.push_back(future.get());
+    }
+    return predictions;
+}
+
+void InferenceBatcher::takeBatch(std::vector<Request>& batch) {
+    const bool useTTA = queue.front().useTTA;
+    for (auto it = queue.begin(); it != queue.end() && batch.size() < static_cast<size_t>(config.maxBatchSize);) {
+        if (it->useTTA == useTTA) {
+            batch.push_back(std::move(*it));
+            it = queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void InferenceBatcher::recordBatch(const std::vector<Request>& batch, Clock::time_point dispatched) {
+    requestCount += batch.size();
+    ++batchSizeCounts[batch.size()];
+    if (batch.size() == static_cast<size_t>(config.maxBatchSize)) ++fullBatchCount;
+
+    for (const auto& request : batch) {
+        float delayMs = std::chrono::duration<float, std::milli>(dispatched - request.submitted).count();
+        delaySumMs += delayMs;
+        delayMaxMs = std::max(delayMaxMs, static_cast<double>(delayMs));
+        if (recentDelaysMs.size() < DELAY_HISTORY) {
+            recentDelaysMs.push_back(delayMs);
+        } else {
+            recentDelaysMs[nextDelaySlot] = delayMs;
+            nextDelaySlot = (nextDelaySlot + 1) % DELAY_HISTORY;
+        }
+    }
+}
+
+// Dispatcher: wait for a first request, then for a full batch or the oldest request's
+// deadline, whichever comes first, and run one forward pass per batch
+void InferenceBatcher::dispatchLoop() {
+    const Clock::duration maxDelay = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(config.maxDelayMs));
+    const size_t maxBatch = static_cast<size_t>(config.maxBatchSize);
+    std::vector<Request> batch;
+    std::vector<cv::Mat> faces;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return !queue.empty() || !running; });
+            if (queue.empty()) break;   // Stopped and drained
+
+            // Stopping dispatches what is queued without waiting
+            Clock::time_point deadline = queue.front().submitted + maxDelay;
+            wake.wait_until(lock, deadline, [this, maxBatch]() { return queue.size() >= maxBatch || !running; });
+
+            takeBatch(batch);
+            recordBatch(batch, Clock::now());
+        }
+
+        faces.clear();
+        for (const auto& request : batch) faces.push_back(request.face);
+        try {
+            std::vector<EmotionPrediction> predictions = classifier.classifyBatch(faces, batch.front().useTTA);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].result.set_value(predictions[i]);
+            }
+        } catch (...) {
+            for (auto& request : batch) request.result.set_exception(std::current_exception());
+        }
+        batch.clear();
+    }
+}
+
+InferenceBatcherStats InferenceBatcher::getStats() const {
+    InferenceBatcherStats stats;
+    std::vector<float> delays;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.requests = requestCount;
+        stats.fullBatches = fullBatchCount;
+        stats.batchSizeCounts = batchSizeCounts;
+        stats.meanDelayMs = requestCount > 0 ? delaySumMs / requestCount : 0.0;
+        stats.maxDelayMs = delayMaxMs;
+        delays = recentDelaysMs;
+    }
+
+    for (size_t size = 1; size < stats.batchSizeCounts.size(); ++size) {
+        stats.batches += stats.batchSizeCounts[size];
+    }
+    stats.meanBatchSize = stats.batches > 0 ? static_cast<double>(stats.requests) / stats.batches : 0.0;
+
+    if (!delays.empty()) {
+        std::sort(delays.begin(), delays.end());
+        auto percentile = [&delays](double p) {
+            return static_cast<double>(delays[static_cast<size_t>(p * (delays.size() - 1))]);
+        };
+        stats.p50DelayMs = percentile(0.50);
+        stats.p95DelayMs = percentile(0.95);
+        stats.p99DelayMs = percentile(0.99);
+    }
+    return stats;
+}
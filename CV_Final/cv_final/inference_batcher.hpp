@@ -0,0 +1,102 @@
+/**
+ * inference_batcher.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the InferenceBatcher class.
+ *              A dynamic request batcher in front of one EmotionClassifier. Any number of
+ *              threads submit face crops and get futures back; a dispatcher thread gathers
+ *              requests until the batch is full or the oldest request has waited for the
+ *              configured deadline, runs a single batched forward pass and fulfils the futures.
+ *              Many callers submitting one or two faces each thus share large batches.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emotion_classifier.hpp"
+
+// Batching parameters (defaults come from config.hpp)
+struct InferenceBatcherConfig {
+    int maxBatchSize;          // Dispatch as soon as this many requests are queued
+    double maxDelayMs;         // Dispatch once the oldest queued request has waited this long
+
+    InferenceBatcherConfig();
+};
+
+// Batching statistics since construction (queueing delays over the most recent requests)
+struct InferenceBatcherStats {
+    uint64_t requests = 0;                 // Faces classified
+    uint64_t batches = 0;                  // Forward passes run
+    uint64_t fullBatches = 0;              // Batches dispatched because they reached maxBatchSize
+    std::vector<uint64_t> batchSizeCounts; // Number of batches of each size (index = size)
+    double meanBatchSize = 0.0;
+    double meanDelayMs = 0.0;              // Time from submit() to the start of the forward pass
+    double p50DelayMs = 0.0, p95DelayMs = 0.0, p99DelayMs = 0.0, maxDelayMs = 0.0;
+};
+
+class InferenceBatcher {
+public:
+    // Constructor: loads the classifier and starts the dispatcher thread
+    InferenceBatcher(const std::string& modelPath, const InferenceEngineConfig& engineConfig = InferenceEngineConfig(),
+                     const InferenceBatcherConfig& config = InferenceBatcherConfig());
+    ~InferenceBatcher();
+
+    InferenceBatcher(const InferenceBatcher&) = delete;
+    InferenceBatcher& operator=(const InferenceBatcher&) = delete;
+
+    // Queue one face. The crop's pixels are not copied: keep them unchanged until the future
+    // is ready. Requests with and without TTA are batched separately. Thread-safe.
+    std::future<EmotionPrediction> submit(const cv::Mat& faceROI, bool useTTA = false);
+
+    // Queue every face at once and wait for all results (in input order). Thread-safe.
+    std::vector<EmotionPrediction> classifyBatch(const std::vector<cv::Mat>& faceROIs, bool useTTA = false);
+
+    // Finish the queued requests and stop the dispatcher (safe to call more than once)
+    void stop();
+
+    InferenceBatcherStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        cv::Mat face;
+        bool useTTA = false;
+        Clock::time_point submitted;
+        std::promise<EmotionPrediction> result;
+    };
+
+    void dispatchLoop();
+
+    // Take up to maxBatchSize queued requests sharing the first one's TTA setting
+    void takeBatch(std::vector<Request>& batch);
+
+    // Add one dispatched batch to the statistics (caller holds the mutex)
+    void recordBatch(const std::vector<Request>& batch, Clock::time_point dispatched);
+
+    InferenceBatcherConfig config;
+    EmotionClassifier classifier;          // Only used by the dispatcher thread
+
+    mutable std::mutex mutex;              // Guards the queue, `running` and the statistics
+    std::condition_variable wake;
+    std::deque<Request> queue;
+    bool running = true;
+
+    uint64_t requestCount = 0;
+    uint64_t fullBatchCount = 0;
+    std::vector<uint64_t> batchSizeCounts;
+    double delaySumMs = 0.0;
+    double delayMaxMs = 0.0;
+    std::vector<float> recentDelaysMs;     // Ring of the latest delays, for percentiles
+    size_t nextDelaySlot = 0;
+
+    std::thread dispatcher;
+};
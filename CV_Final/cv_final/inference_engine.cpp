@@ -0,0 +1,126 @@
+/**
+ * inference_engine.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the OpenCV DNN engine and the engine factory.
+ */
+
+#include "inference_engine.hpp"
+#include "assets.hpp"
+#include "calibration.hpp"
+#include "config.hpp"
+
+#ifdef HAVE_ONNXRUNTIME
+#include "onnxruntime_engine.hpp"
+#endif
+
+#include <stdexcept>
+
+// Defaults from config.hpp
+InferenceEngineConfig::InferenceEngineConfig()
+    : backend(parseInferenceBackend(config::INFERENCE_BACKEND)),
+      dnnBackend(config::DNN_BACKEND),
+      dnnTarget(config::DNN_TARGET),
+      numThreads(config::INFERENCE_THREADS),
+      interOpThreads(config::ORT_INTER_OP_THREADS),
+      graphOptimizationLevel(config::ORT_GRAPH_OPTIMIZATION_LEVEL),
+      precision(parseInferencePrecision(config::INFERENCE_PRECISION)),
+      int8ModelPath(config::INT8_MODEL_PATH),
+      calibrationPath(config::INT8_CALIBRATION_PATH) {}
+
+// FP16 variant of a cv::dnn target. The CPU has one from OpenCV 4.9; older versions keep FP32.
+static int halfPrecisionTarget(int target) {
+    switch (target) {
+    case cv::dnn::DNN_TARGET_OPENCL: return cv::dnn::DNN_TARGET_OPENCL_FP16;
+    case cv::dnn::DNN_TARGET_CUDA: return cv::dnn::DNN_TARGET_CUDA_FP16;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)
+    case cv::dnn::DNN_TARGET_CPU: return cv::dnn::DNN_TARGET_CPU_FP16;   // ARM with FP16 arithmetic
+#endif
+    default: return target;
+    }
+}
+
+// Constructor: load the ONNX model (or its INT8 version; from memory if built in) and select where it runs
+OpenCvDnnEngine::OpenCvDnnEngine(const std::string& modelPath, const InferenceEngineConfig& config) {
+    bool prequantized = config.precision == InferencePrecision::INT8 && !config.int8ModelPath.empty();
+    const std::string& path = prequantized ? config.int8ModelPath : modelPath;
+    if (const Assets::EmbeddedAsset* embedded = Assets::findEmbedded(path)) {
+        net = cv::dnn::readNetFromONNX(reinterpret_cast<const char*>(embedded->data), embedded->size);
+    } else {
+        net = cv::dnn::readNetFromONNX(path);
+    }
+    if (net.empty()) {
+        throw std::runtime_error("Failed to load ONNX model from path: " + path);
+    }
+
+    // Static INT8 quantization of the FP32 model, with activation ranges from the calibration set
+    if (config.precision == InferencePrecision::INT8 && !prequantized) {
+        if (config.calibrationPath.empty()) {
+            throw std::runtime_error("INT8 needs a quantized model or a calibration file (run calibrate)");
+        }
+        cv::Mat calibration = readCalibrationTensor(config.calibrationPath);
+        net = net.quantize(calibration, CV_32F, CV_32F);
+    }
+
+    net.setPreferableBackend(config.dnnBackend);
+    int target = config.precision == InferencePrecision::FP16 ? halfPrecisionTarget(config.dnnTarget) : config.dnnTarget;
+    net.setPreferableTarget(target);
+    if (config.precision != InferencePrecision::FP32) {
+        suffix = std::string("/") + precisionName(config.precision);
+    }
+
+    // cv::dnn has no per-network thread setting; this applies to the whole process
+    if (config.numThreads > 0) {
+        cv::setNumThreads(config.numThreads);
+    }
+}
+
+cv::Mat OpenCvDnnEngine::infer(const cv::Mat& blob) {
+    net.setInput(blob);
+    cv::Mat output = net.forward();
+    return output.reshape(1, blob.size[0]);
+}
+
+std::unique_ptr<InferenceEngine> createInferenceEngine(const std::string& modelPath,
+                                                       const InferenceEngineConfig& config) {
+    switch (config.backend) {
+    case InferenceBackend::OnnxRuntime:
+#ifdef HAVE_ONNXRUNTIME
+        return std::make_unique<OnnxRuntimeEngine>(modelPath, config);
+#else
+        throw std::runtime_error("ONNX Runtime backend requested, but this build was compiled without HAVE_ONNXRUNTIME");
+#endif
+    case InferenceBackend::OpenCvDnn:
+    default:
+        return std::make_unique<OpenCvDnnEngine>(modelPath, config);
+    }
+}
+
+InferenceBackend parseInferenceBackend(const std::string& name) {
+    if (name == "opencv" || name == "opencv-dnn") return InferenceBackend::OpenCvDnn;
+    if (name == "onnxruntime" || name == "ort") return InferenceBackend::OnnxRuntime;
+    throw std::invalid_argument("Unknown inference backend: " + name + " (expected opencv or onnxruntime)");
+}
+
+InferencePrecision parseInferencePrecision(const std::string& name) {
+    if (name == "fp32") return InferencePrecision::FP32;
+    if (name == "fp16") return InferencePrecision::FP16;
+    if (name == "int8") return InferencePrecision::INT8;
+    throw std::invalid_argument("Unknown inference precision: " + name + " (expected fp32, fp16 or int8)");
+}
+
+const char* precisionName(InferencePrecision precision) {
+    switch (precision) {
+    case InferencePrecision::FP16: return "fp16";
+    case InferencePrecision::INT8: return "int8";
+    default: return "fp32";
+    }
+}
+
+bool isBackendAvailable(InferenceBackend backend) {
+#ifdef HAVE_ONNXRUNTIME
+    (void)backend;
+    return true;
+#else
+    return backend == InferenceBackend::OpenCvDnn;
+#endif
+}
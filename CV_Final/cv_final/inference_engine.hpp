@@ -0,0 +1,79 @@
+/**
+ * inference_engine.hpp
+ * Author: Niloofar Karimi
+ * Description: Abstract interface for running the emotion model, so EmotionClassifier can use
+ *              different inference libraries without changing its preprocessing or batching.
+ *              Engines can run the model in FP32, FP16 (where the backend supports it) or
+ *              INT8 (a pre-quantized model, or OpenCV's static quantization from a
+ *              calibration set produced by calibrate.cpp).
+ *              Provides the OpenCV DNN engine; the ONNX Runtime engine lives in
+ *              onnxruntime_engine.hpp and is only built with HAVE_ONNXRUNTIME defined.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <memory>
+#include <string>
+
+// Available inference libraries
+enum class InferenceBackend { OpenCvDnn, OnnxRuntime };
+
+// Numeric precision of the forward pass
+enum class InferencePrecision { FP32, FP16, INT8 };
+
+// Settings for creating an inference engine (defaults come from config.hpp)
+struct InferenceEngineConfig {
+    InferenceBackend backend;
+    int dnnBackend;            // cv::dnn::Backend for the OpenCV engine
+    int dnnTarget;             // cv::dnn::Target for the OpenCV engine
+    int numThreads;            // OpenCV: cv::setNumThreads (process-wide); ONNX Runtime: intra-op threads. 0 = library default
+    int interOpThreads;        // ONNX Runtime: threads running independent graph nodes. 0 = library default
+    int graphOptimizationLevel;  // ONNX Runtime: 0 = disabled, 1 = basic, 2 = extended, 3 = all
+    InferencePrecision precision;
+    std::string int8ModelPath;   // INT8: statically quantized ONNX model (empty = quantize at load)
+    std::string calibrationPath; // INT8 without a quantized model: .npy calibration tensor
+
+    InferenceEngineConfig();
+};
+
+// Runs the model on a preprocessed [N, H, W, 1] float tensor
+class InferenceEngine {
+public:
+    virtual ~InferenceEngine() = default;
+
+    // Returns an N x numClasses CV_32F score matrix. The result may refer to memory owned by
+    // the engine and is only valid until the next call.
+    virtual cv::Mat infer(const cv::Mat& blob) = 0;
+
+    // Short backend name used in logs and benchmark IDs
+    virtual std::string name() const = 0;
+};
+
+// OpenCV DNN engine with configurable backend, target and thread count
+class OpenCvDnnEngine : public InferenceEngine {
+public:
+    OpenCvDnnEngine(const std::string& modelPath, const InferenceEngineConfig& config);
+
+    cv::Mat infer(const cv::Mat& blob) override;
+    std::string name() const override { return "opencv-dnn" + suffix; }
+
+private:
+    cv::dnn::Net net;   // Loaded ONNX model
+    std::string suffix; // Precision tag appended to name()
+};
+
+// Create the engine selected by config.backend. Throws std::runtime_error if the model cannot
+// be loaded or the backend was not compiled in.
+std::unique_ptr<InferenceEngine> createInferenceEngine(const std::string& modelPath,
+                                                       const InferenceEngineConfig& config);
+
+// Parse "opencv" or "onnxruntime" (throws std::invalid_argument otherwise)
+InferenceBackend parseInferenceBackend(const std::string& name);
+
+// Parse "fp32", "fp16" or "int8" (throws std::invalid_argument otherwise)
+InferencePrecision parseInferencePrecision(const std::string& name);
+const char* precisionName(InferencePrecision precision);
+
+// True if the backend is available in this build
+bool isBackendAvailable(InferenceBackend backend);
@@ -2,162 +2,347 @@
  * main.cpp
  * Author: Niloofar Karimi
  * Description: Real-time facial emotion recognition pipeline using OpenCV and ONNX.
- *              Captures webcam input, performs face detection and alignment,
- *              runs emotion classification with optional test-time augmentation (TTA),
- *              applies smoothing and confidence filtering, and logs results to CSV.
+ *              Captures webcam input (or a video file, image sequence or image directory),
+ *              performs face detection and alignment, runs emotion classification with
+ *              optional test-time augmentation (TTA), applies smoothing and confidence
+ *              filtering, and logs results to CSV. Capture, detection and classification
+ *              run as overlapping stages (see pipeline.hpp); the README describes each option.
+ *
+ * Usage: emotion_app [--input <camera index | video | pattern | dir>] [--headless]
+ *                    [--output-video out.mp4] [--realtime] [--tta] [--tta-mode off|on|adaptive]
+ *                    [--backend opencv|onnxruntime]
+ *                    [--smoothing ema|vote|off] [--target-fps 15] [--latency-slo 200] [--no-shedding]
+ *                    [--no-cache] [--luma] [--assets <dir>]
  */
 
 #ifdef RUN_REALTIME
 
 #include <opencv2/highgui.hpp>
 #include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <future>
 #include <iostream>
-#include <deque>
-#include <unordered_map>
-#include <fstream>  // For saving results to CSV
+#include <stdexcept>
 
+#include "assets.hpp"
 #include "config.hpp"
-#include "face_detector.hpp"
-#include "emotion_classifier.hpp"
+#include "emotion_smoother.hpp"
+#include "frame_source.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
+#include "result_logger.hpp"
+#include "startup_profile.hpp"
 #include "video_overlay.hpp"
-#include "utils.hpp"
 
-const int SMOOTHING_WINDOW = 5;
-
-// Get the most frequent prediction label from a rolling buffer
-std::string getSmoothedPrediction(const std::deque<std::string>& buffer) {
-    std::unordered_map<std::string, int> freq;
-    for (const auto& label : buffer) freq[label]++;
-
-    std::string majorityLabel;
-    int maxCount = 0;
-    for (const auto& [label, count] : freq) {
-        if (count > maxCount) {
-            maxCount = count;
-            majorityLabel = label;
-        }
-    }
-    return majorityLabel;
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--input SOURCE] [--headless] [--output-video FILE] [--realtime] [--tta]"
+              << " [--tta-mode MODE] [--backend NAME] [--smoothing MODE] [--target-fps FPS] [--latency-slo MS]"
+              << " [--no-shedding] [--no-cache]\n"
+              << "  --input         camera index, video file, image sequence pattern (img_%04d.png)\n"
+              << "                  or directory of images (default: camera 0)\n"
+              << "  --headless      no preview window; report FPS on the console\n"
+              << "  --output-video  write annotated frames to this video file\n"
+              << "  --realtime      play file sources at their frame rate instead of as fast as possible\n"
+              << "  --tta           start with test-time augmentation enabled (same as --tta-mode on)\n"
+              << "  --tta-mode      TTA at startup: off, on or adaptive (low-confidence faces only, within\n"
+              << "                  " << config::TTA_ADAPTIVE_MAX_EXTRA_FORWARDS << " extra forwards per frame)"
+              << " (default: " << config::TTA_MODE << "; 'T' cycles)\n"
+              << "  --backend       inference engine: opencv or onnxruntime (default: " << config::INFERENCE_BACKEND << ")\n"
+              << "  --smoothing     per-face smoothing over time: ema, vote or off (default: " << config::SMOOTHING_MODE << ")\n"
+              << "  --target-fps    frame rate load shedding holds (default: " << config::SHED_TARGET_FPS << ")\n"
+              << "  --latency-slo   capture-to-display latency load shedding holds, in ms (default: "
+              << config::SHED_LATENCY_SLO_MS << ")\n"
+              << "  --no-shedding   never lower quality to keep up (live and paced sources shed by default)\n"
+              << "  --no-cache      classify every face every frame, even when its crop has not changed\n"
+              << "  --luma          read only the brightness plane; shown frames are converted to color\n"
+              << "                  (headless runs without an output video read it by default)\n"
+              << "  --assets        directory with the model and cascades (default: $" << config::ASSET_DIR_ENV
+              << ", built-in assets, or " << config::ASSET_DIR << ")\n";
 }
 
-// Align face using detected eyes (only applies if exactly 2 eyes found)
-cv::Mat alignFace(const cv::Mat& faceROI, cv::CascadeClassifier& eye_cascade) {
-    std::vector<cv::Rect> eyes;
-    eye_cascade.detectMultiScale(faceROI, eyes, 1.1, 2, 0, cv::Size(20, 20));
-    if (eyes.size() != 2) return faceROI;
-
-    // Calculate center points of both eyes
-    cv::Point2f eye1(eyes[0].x + eyes[0].width / 2.0f, eyes[0].y + eyes[0].height / 2.0f);
-    cv::Point2f eye2(eyes[1].x + eyes[1].width / 2.0f, eyes[1].y + eyes[1].height / 2.0f);
-    if (eye2.x < eye1.x) std::swap(eye1, eye2);
-
-    // Compute rotation angle between the eyes
-    double dx = eye2.x - eye1.x;
-    double dy = eye2.y - eye1.y;
-    double angle = atan2(dy, dx) * 180.0 / CV_PI;
-
-    // Rotate face to horizontally align eyes
-    cv::Point2f center(faceROI.cols / 2.0f, faceROI.rows / 2.0f);
-    cv::Mat rot_mat = cv::getRotationMatrix2D(center, angle, 1.0);
-
-    cv::Mat aligned;
-    cv::warpAffine(faceROI, aligned, rot_mat, faceROI.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
-    return aligned;
-}
-
-int main() {
+int main(int argc, char** argv) {
     try {
-        // Open webcam
-        cv::VideoCapture cap(0);
-        if (!cap.isOpened()) {
-            std::cerr << "Error: Could not open webcam." << std::endl;
-            return -1;
-        }
-
-        // Initialize classifier and detectors
-        EmotionClassifier classifier(config::MODEL_PATH);
-        FaceDetector detector(config::FACE_CASCADE_PATH);
-
-        // Load eye detector for face alignment
-        cv::CascadeClassifier eye_cascade;
-        if (!eye_cascade.load("/Users/niloofarkarimi/CV_Final/resources/haarcascade_eye.xml")) {
-            std::cerr << "Error: Could not load eye cascade." << std::endl;
-            return -1;
+        StartupProfile startup;
+
+        // Parse command-line options (no options: webcam 0 with a preview window)
+        FrameSourceConfig sourceConfig;
+        sourceConfig.readAhead = config::READ_AHEAD_FRAMES;
+        sourceConfig.sequenceFps = config::DEFAULT_SEQUENCE_FPS;
+        bool luma = false;
+        bool headless = false;
+        TtaMode startTtaMode = parseTtaMode(config::TTA_MODE);
+        InferenceEngineConfig engineConfig;
+        EmotionSmootherConfig smootherConfig;
+        QualityControllerConfig qualityConfig;
+        ResultCacheConfig cacheConfig;
+        std::string outputVideoPath;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--input" && i + 1 < argc) {
+                sourceConfig.input = argv[++i];
+            } else if (arg == "--headless") {
+                headless = true;
+            } else if (arg == "--output-video" && i + 1 < argc) {
+                outputVideoPath = argv[++i];
+            } else if (arg == "--realtime") {
+                sourceConfig.realtimePacing = true;
+            } else if (arg == "--tta") {
+                startTtaMode = TtaMode::On;
+            } else if (arg == "--tta-mode" && i + 1 < argc) {
+                startTtaMode = parseTtaMode(argv[++i]);
+            } else if (arg == "--backend" && i + 1 < argc) {
+                engineConfig.backend = parseInferenceBackend(argv[++i]);
+            } else if (arg == "--smoothing" && i + 1 < argc) {
+                smootherConfig.mode = parseSmoothingMode(argv[++i]);
+            } else if (arg == "--target-fps" && i + 1 < argc) {
+                qualityConfig.targetFps = std::stod(argv[++i]);
+            } else if (arg == "--latency-slo" && i + 1 < argc) {
+                qualityConfig.latencySloMs = std::stod(argv[++i]);
+            } else if (arg == "--no-shedding") {
+                qualityConfig.enabled = false;
+            } else if (arg == "--no-cache") {
+                cacheConfig.enabled = false;
+            } else if (arg == "--luma") {
+                luma = true;
+            } else if (arg == "--assets" && i + 1 < argc) {
+                Assets::setDirectory(argv[++i]);
+            } else if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                printUsage(argv[0]);
+                return -1;
+            }
         }
 
-        std::deque<std::string> predictionBuffer;
-        bool useTTA = false;
-        cv::Mat frame;
-
-        // Open CSV file to save frame-by-frame results
-        std::ofstream csvFile("results.csv");
-        csvFile << "Frame,Emotion,Confidence,TTA\n";
-        int frameCount = 0;
-
-        while (true) {
-            cap >> frame;
-            if (frame.empty()) break;
-
-            // Convert to grayscale for detection
-            cv::Mat gray = Utils::toGrayscale(frame);
-            std::vector<cv::Rect> faces = detector.detect(gray);
-
-            std::vector<std::string> smoothedLabels;
-            std::vector<float> confidences;
-
-            for (const auto& face : faces) {
-                // Align the detected face using eyes
-                cv::Mat faceROI = gray(face).clone();
-                cv::Mat aligned = alignFace(faceROI, eye_cascade);
-
-                float confidence = 0.0f;
-                std::string emotion;
-
-                // Run emotion classification (with or without TTA)
-                if (useTTA) {
-                    emotion = classifier.classifyWithTTA(aligned, &confidence);
-                } else {
-                    emotion = classifier.classify(aligned, &confidence);
+        // Shown or recorded luma frames keep their chroma; only those are converted to BGR
+        const bool annotate = !headless || !outputVideoPath.empty();
+        sourceConfig.luma = luma || config::LUMA_INGEST;
+        sourceConfig.keepColor = annotate;
+
+        // Open the frame source (webcam, video file, image sequence or directory) on its own
+        // thread while the pipeline loads
+        std::future<std::unique_ptr<FrameReader>> openingReader = std::async(std::launch::async, [&]() {
+            return startup.measure("open source", [&]() { return std::make_unique<FrameReader>(sourceConfig); });
+        });
+
+        // Initialize the staged pipeline (classifiers, face detector and eye cascades, loaded
+        // in parallel and warmed up)
+        PipelineConfig pipelineConfig;
+        pipelineConfig.modelPath = Assets::modelPath();
+        pipelineConfig.faceCascadePath = Assets::faceCascadePath();
+        pipelineConfig.eyeCascadePath = Assets::eyeCascadePath();
+        pipelineConfig.warmUp = config::WARMUP_INFERENCE;
+        pipelineConfig.engine = engineConfig;
+        pipelineConfig.classifyWorkers = config::PIPELINE_CLASSIFY_WORKERS;
+        pipelineConfig.queueCapacity = config::PIPELINE_QUEUE_CAPACITY;
+        pipelineConfig.maxBatchSize = config::MAX_BATCH_SIZE;
+        pipelineConfig.useTracking = config::USE_FACE_TRACKING;
+        // Live and paced sources drop frames to stay current; offline runs process every frame
+        pipelineConfig.dropFrames = FrameReader::isCameraInput(sourceConfig.input) || sourceConfig.realtimePacing;
+        // ...and trade quality for time when they cannot keep up
+        qualityConfig.enabled = qualityConfig.enabled && pipelineConfig.dropFrames;
+        pipelineConfig.quality = qualityConfig;
+        pipelineConfig.cache = cacheConfig;
+        pipelineConfig.lowResDetectWidth = config::SHED_LOW_RES_DETECT_WIDTH;
+        pipelineConfig.reuseMaxAge = config::SHED_REUSE_MAX_AGE;
+        Pipeline pipeline(pipelineConfig, &startup);
+        pipeline.setTtaMode(startTtaMode);
+        std::unique_ptr<FrameReader> reader = openingReader.get();
+
+        // Annotated output video, opened on the first frame once the frame size is known
+        cv::VideoWriter videoWriter;
+
+        // Per-track smoothing (faces without a track ID are shown unsmoothed)
+        EmotionSmoother smoother(smootherConfig);
+        std::vector<std::string> smoothedLabels;   // Per-frame overlay inputs, reused across frames
+        std::vector<float> confidences;
+        std::vector<int> unstableTracks;           // Fed back to the pipeline (adaptive TTA, reuse)
+        std::vector<std::string> statusLines;      // Overlay panel: load-shedding level (and profiler HUD)
+        cv::Mat colorFrame;                        // BGR version of a luma frame being shown
+        QualityLevel shownLevel = QualityLevel::Full;
+
+#ifdef ENABLE_PROFILING
+        Profiler::configure(config::PROFILE_OUTPUT_PATH, config::PROFILE_FLUSH_INTERVAL_SEC);
+        bool showProfilerHud = config::SHOW_PROFILER_HUD;
+#endif
+
+        // Frame-by-frame results are written by a background thread
+        ResultLoggerConfig loggerConfig;
+        loggerConfig.path = config::RESULTS_PATH;
+        loggerConfig.format = logFormatForPath(config::RESULTS_PATH);
+        loggerConfig.capacity = config::LOG_QUEUE_CAPACITY;
+        loggerConfig.echoToConsole = config::LOG_ECHO_TO_CONSOLE;
+        loggerConfig.qualityColumn = qualityConfig.enabled;
+        ResultLogger logger(loggerConfig);
+
+        // Capture stage: read the next frame
+        auto source = [&reader](cv::Mat& frame) {
+            return reader->read(frame);
+        };
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto lastReport = startTime;
+        uint64_t framesDone = 0;
+        double runStartMs = 0.0;                   // When the pipeline started, on the startup clock
+
+        // Render stage: runs on this thread with frames in capture order
+        auto sink = [&](FrameResult& result) {
+            smoothedLabels.resize(result.predictions.size());
+            confidences.resize(result.predictions.size());
+            unstableTracks.clear();
+            const int quality = qualityConfig.enabled ? static_cast<int>(result.quality) : -1;
+
+            for (size_t i = 0; i < result.predictions.size(); ++i) {
+                const auto& prediction = result.predictions[i];
+                float confidence = prediction.confidence;
+
+                // Queue for the logger thread (console echo and CSV); never blocks.
+                // Low-confidence predictions are reported as "Uncertain".
+                logger.log(result.index, result.trackIds[i], result.faces[i], emotionLabel(prediction), confidence,
+                           result.usedTTA || result.escalated[i], -1, quality);
+
+                // Smooth over this person's recent predictions
+                PROFILE_SCOPE(Smoothing);
+                SmoothedEmotion smoothed = smoother.update(result.trackIds[i], prediction);
+                smoothedLabels[i] = emotionLabel(smoothed.classId);
+                confidences[i] = smoothed.confidence;
+                if (smoother.isUnstable(result.trackIds[i])) {
+                    unstableTracks.push_back(result.trackIds[i]);
                 }
+            }
+            smoother.endFrame();
+            pipeline.setUnstableTracks(unstableTracks);
+
+            // Report load-shedding level changes with the costs that caused them
+            const QualityController& controller = pipeline.getQualityController();
+            if (controller.getLevel() != shownLevel) {
+                shownLevel = controller.getLevel();
+                std::cout << "Quality level: " << qualityLevelName(shownLevel) << " (slowest stage "
+                          << controller.getStageMs() << " ms of " << controller.getBudgetMs() << " ms budget, latency "
+                          << controller.getLatencyMs() << " ms)" << std::endl;
+            }
 
-                // Filter low-confidence predictions
-                if (confidence < 0.2f) {
-                    emotion = "Uncertain";
+            // Draw predictions, then show and/or record the frame
+            if (annotate) {
+                PROFILE_SCOPE(Render);
+                cv::Mat& shown = reader->toBgr(result.frame, colorFrame);
+                VideoOverlay::drawDetections(shown, result.faces, smoothedLabels, confidences);
+                // The first line's string is kept across frames, so formatting it does not allocate
+                statusLines.resize(qualityConfig.enabled ? 1 : 0);
+                if (qualityConfig.enabled) {
+                    char line[64];
+                    std::snprintf(line, sizeof(line), "Quality: %s (%.0f ms / %.0f ms)",
+                                  qualityLevelName(result.quality), controller.getStageMs(), controller.getBudgetMs());
+                    statusLines[0].assign(line);
                 }
+#ifdef ENABLE_PROFILING
+                if (showProfilerHud) {
+                    for (const auto& hudLine : Profiler::hudLines()) statusLines.push_back(hudLine);
+                }
+#endif
+                VideoOverlay::drawStats(shown, statusLines);
+                if (!headless) {
+                    cv::imshow("Emotion Recognition", shown);
+                }
+                if (!outputVideoPath.empty()) {
+                    if (!videoWriter.isOpened()) {
+                        videoWriter.open(outputVideoPath, cv::VideoWriter::fourcc('m', 'p', '4', 'v'),
+                                         reader->getFps(), shown.size());
+                        if (!videoWriter.isOpened()) {
+                            throw std::runtime_error("Could not open output video: " + outputVideoPath);
+                        }
+                    }
+                    videoWriter.write(shown);
+                }
+            }
+            ++framesDone;
 
-                // Log to console and to CSV
-                std::string prefix = useTTA ? "TTA " : "";
-                std::cout << prefix << emotion << " (" << confidence << ")" << std::endl;
-                csvFile << frameCount << "," << emotion << "," << confidence << "," << (useTTA ? "Yes" : "No") << "\n";
-
-                // Add to smoothing buffer
-                predictionBuffer.push_back(emotion);
-                if (predictionBuffer.size() > SMOOTHING_WINDOW)
-                    predictionBuffer.pop_front();
-
-                std::string smoothed = getSmoothedPrediction(predictionBuffer);
-                smoothedLabels.push_back(smoothed);
-                confidences.push_back(confidence);
+            // Startup ends with the first frame on screen (or recorded)
+            if (framesDone == 1) {
+                startup.record("first frame", runStartMs, startup.elapsedMs());
+                if (config::PRINT_STARTUP_REPORT) startup.print(std::cout);
             }
 
-            // Draw predictions and show video
-            VideoOverlay::drawDetections(frame, faces, smoothedLabels, confidences);
-            cv::imshow("Emotion Recognition", frame);
+            PROFILE_RECORD(Frame, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - result.captureTime).count());
+#ifdef ENABLE_PROFILING
+            Profiler::flushIfDue();
+#endif
+
+            // Headless: periodic throughput report instead of GUI event handling
+            if (headless) {
+                auto now = std::chrono::steady_clock::now();
+                double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+                if (sinceReport >= config::HEADLESS_REPORT_INTERVAL_SEC) {
+                    double elapsed = std::chrono::duration<double>(now - startTime).count();
+                    std::cout << "Processed " << framesDone << " frames (" << framesDone / elapsed << " FPS)";
+                    PipelineStats stats = pipeline.getStats();
+                    if (stats.cacheLookups > 0) {
+                        std::cout << ", cache hits " << 100.0 * stats.cacheHits / stats.cacheLookups << "%";
+                    }
+                    if (stats.adaptiveFaces > 0) {
+                        std::cout << ", TTA escalations " << 100.0 * stats.escalatedFaces / stats.adaptiveFaces << "%";
+                    }
+                    std::cout << std::endl;
+                    lastReport = now;
+                }
+                return true;
+            }
 
             int key = cv::waitKey(1);
-            if (key == 27) break; // ESC to quit
+            if (key == 27) return false; // ESC to quit
             if (key == 't' || key == 'T') {
-                useTTA = !useTTA;
-                std::cout << "TTA toggled " << (useTTA ? "ON" : "OFF") << std::endl;
+                // Cycle off -> on -> adaptive
+                TtaMode mode = pipeline.getTtaMode();
+                mode = mode == TtaMode::Off ? TtaMode::On : mode == TtaMode::On ? TtaMode::Adaptive : TtaMode::Off;
+                pipeline.setTtaMode(mode);
+                std::cout << "TTA mode: " << ttaModeName(mode) << std::endl;
             }
-
-            frameCount++;
+#ifdef ENABLE_PROFILING
+            if (key == 'p' || key == 'P') {
+                showProfilerHud = !showProfilerHud;
+            }
+#endif
+            return true;
+        };
+
+        runStartMs = startup.elapsedMs();
+        pipeline.run(source, sink);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        PipelineStats stats = pipeline.getStats();
+        std::cout << "Frames captured: " << stats.captured
+                  << ", rendered: " << stats.rendered
+                  << ", dropped: " << stats.dropped << ", ingest: " << reader->getIngestName() << std::endl;
+        if (stats.cacheLookups > 0) {
+            std::cout << "Result cache: " << stats.cacheHits << " of " << stats.cacheLookups << " tracked faces reused ("
+                      << 100.0 * stats.cacheHits / stats.cacheLookups << "% hit rate)" << std::endl;
+        }
+        if (qualityConfig.enabled) {
+            std::cout << "Load shedding: final level " << qualityLevelName(pipeline.getQualityLevel())
+                      << ", frames shed: " << stats.shed << ", predictions reused: " << stats.reusedFaces << std::endl;
         }
+        if (stats.adaptiveFaces > 0) {
+            std::cout << "Adaptive TTA: escalated " << stats.escalatedFaces << " of " << stats.adaptiveFaces
+                      << " faces (" << 100.0 * stats.escalatedFaces / stats.adaptiveFaces << "%)" << std::endl;
+        }
+        std::cout << "Elapsed: " << elapsed << " s, average FPS: "
+                  << (elapsed > 0.0 ? stats.rendered / elapsed : 0.0) << std::endl;
 
         // Clean up resources
-        csvFile.close();
-        cap.release();
-        cv::destroyAllWindows();
+        logger.close();
+        std::cout << "Results logged: " << logger.getWritten()
+                  << ", dropped: " << logger.getDropped() << std::endl;
+        reader->close();
+        videoWriter.release();
+        if (!headless) {
+            cv::destroyAllWindows();
+        }
 
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
@@ -0,0 +1,189 @@
+/**
+ * multistream.cpp
+ * Author: Niloofar Karimi
+ * Description: Headless multi-stream runner. Processes any number of cameras, video files,
+ *              image sequences or image directories in one process through StreamServer
+ *              (a shared pool of models and detectors with fair per-stream scheduling), logs
+ *              every face to one results file with a Stream column, and periodically reports
+ *              per-stream throughput. Video files stand in for cameras with --realtime.
+ *              With --batch, faces from all workers are classified through one shared
+ *              InferenceBatcher and its batch-size and queueing-delay statistics are reported.
+ *
+ * Usage: multistream <source[@fps]>... [--fps 15] [--workers N] [--realtime] [--duration SEC]
+ *                    [--output results.csv] [--tta] [--no-tracking] [--batch] [--batch-delay MS]
+ *                    [--backend opencv|onnxruntime]
+ */
+
+#ifdef RUN_MULTISTREAM
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "result_logger.hpp"
+#include "stream_server.hpp"
+
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <source[@fps]>... [--fps N] [--workers N] [--realtime] [--duration SEC]"
+              << " [--output FILE] [--tta] [--no-tracking] [--batch] [--batch-delay MS] [--backend NAME]\n"
+              << "  source        camera index, video file, image sequence pattern or image directory,\n"
+              << "                optionally followed by @fps to set that stream's target frame rate\n"
+              << "  --fps         target frame rate of streams without @fps (default: " << config::STREAM_DEFAULT_FPS << ")\n"
+              << "  --workers     shared worker pool size (default: one per hardware thread, at most one per stream)\n"
+              << "  --realtime    treat files like cameras: skip frames to keep up with their own frame rate\n"
+              << "  --duration    stop after this many seconds (default: run until every source ends)\n"
+              << "  --output      results file, CSV or .bin (default: " << config::RESULTS_PATH << ")\n"
+              << "  --tta         apply test-time augmentation to every face\n"
+              << "  --no-tracking detect faces on every frame instead of tracking between keyframes\n"
+              << "  --batch       classify all workers' faces in shared batches (one model)\n"
+              << "  --batch-delay longest wait for a batch to fill, in ms (default: " << config::BATCHER_MAX_DELAY_MS << ")\n"
+              << "  --backend     inference engine: opencv or onnxruntime (default: " << config::INFERENCE_BACKEND << ")\n";
+}
+
+// Split "input@fps" into its parts (no suffix = default frame rate)
+static StreamSpec parseStream(const std::string& arg) {
+    StreamSpec spec;
+    spec.input = arg;
+    size_t at = arg.rfind('@');
+    if (at != std::string::npos && at + 1 < arg.size()) {
+        try {
+            size_t used = 0;
+            double fps = std::stod(arg.substr(at + 1), &used);
+            if (used == arg.size() - at - 1) {
+                spec.input = arg.substr(0, at);
+                spec.targetFps = fps;
+            }
+        } catch (const std::exception&) {
+            // Not a frame rate: '@' is part of the path
+        }
+    }
+    return spec;
+}
+
+// Print one line of counters per stream
+static void printStats(const std::vector<StreamStats>& stats) {
+    char line[256];
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const StreamStats& s = stats[i];
+        std::snprintf(line, sizeof(line),
+                      "[%zu] %-28.28s %6.1f/%4.1f FPS  frames %8llu  faces %8llu  skipped %6llu  late %5llu  %6.1f ms%s\n",
+                      i, s.input.c_str(), s.achievedFps, s.targetFps,
+                      static_cast<unsigned long long>(s.processed), static_cast<unsigned long long>(s.faces),
+                      static_cast<unsigned long long>(s.skipped), static_cast<unsigned long long>(s.late),
+                      s.meanLatencyMs, s.finished ? "  (done)" : "");
+        std::cout << line;
+    }
+    std::cout.flush();
+}
+
+// Print the shared batcher's batch-size distribution and queueing delays
+static void printBatcherStats(const InferenceBatcherStats& stats) {
+    std::cout << "Batcher: " << stats.requests << " faces in " << stats.batches << " batches (mean size "
+              << stats.meanBatchSize << ", " << stats.fullBatches << " full), queueing delay mean "
+              << stats.meanDelayMs << " ms, p50 " << stats.p50DelayMs << ", p95 " << stats.p95DelayMs
+              << ", p99 " << stats.p99DelayMs << ", max " << stats.maxDelayMs << " ms\n";
+    std::cout << "Batch sizes:";
+    for (size_t size = 1; size < stats.batchSizeCounts.size(); ++size) {
+        if (stats.batchSizeCounts[size] > 0) std::cout << " " << size << "x" << stats.batchSizeCounts[size];
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv) {
+    try {
+        StreamServerConfig serverConfig;
+        std::vector<StreamSpec> specs;
+        std::string outputPath = config::RESULTS_PATH;
+        double duration = 0.0;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--fps" && i + 1 < argc) {
+                serverConfig.defaultFps = std::stod(argv[++i]);
+            } else if (arg == "--workers" && i + 1 < argc) {
+                serverConfig.workers = std::stoi(argv[++i]);
+            } else if (arg == "--realtime") {
+                serverConfig.realtimeFiles = true;
+            } else if (arg == "--duration" && i + 1 < argc) {
+                duration = std::stod(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "--tta") {
+                serverConfig.useTTA = true;
+            } else if (arg == "--no-tracking") {
+                serverConfig.useTracking = false;
+            } else if (arg == "--batch") {
+                serverConfig.batchInference = true;
+            } else if (arg == "--batch-delay" && i + 1 < argc) {
+                serverConfig.batchDelayMs = std::stod(argv[++i]);
+            } else if (arg == "--backend" && i + 1 < argc) {
+                serverConfig.engine.backend = parseInferenceBackend(argv[++i]);
+            } else if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg.rfind("--", 0) != 0) {
+                specs.push_back(parseStream(arg));
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                printUsage(argv[0]);
+                return -1;
+            }
+        }
+        if (specs.empty()) {
+            printUsage(argv[0]);
+            return -1;
+        }
+
+        // One results file for all streams; the logger is safe to call from every worker
+        ResultLoggerConfig loggerConfig;
+        loggerConfig.path = outputPath;
+        loggerConfig.format = logFormatForPath(outputPath);
+        loggerConfig.capacity = config::LOG_QUEUE_CAPACITY;
+        loggerConfig.streamColumn = true;
+        ResultLogger logger(loggerConfig);
+
+        StreamServer server(serverConfig, specs);
+        std::cout << "Processing " << specs.size() << " streams on " << server.getWorkerCount()
+                  << " workers" << std::endl;
+
+        server.start([&logger](int stream, const FrameResult& result) {
+            for (size_t i = 0; i < result.predictions.size(); ++i) {
+                const auto& prediction = result.predictions[i];
+                // Low-confidence predictions are logged as "Uncertain"
+                logger.log(result.index, result.trackIds[i], result.faces[i], emotionLabel(prediction), prediction.confidence,
+                           result.usedTTA, stream);
+            }
+        });
+
+        // Report until every stream ends or the duration elapses
+        auto startTime = std::chrono::steady_clock::now();
+        auto reportInterval = std::chrono::milliseconds(static_cast<int>(config::STREAM_REPORT_INTERVAL_SEC * 1000));
+        while (!server.waitFor(reportInterval)) {
+            printStats(server.getStats());
+            if (serverConfig.batchInference) printBatcherStats(server.getBatcherStats());
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            if (duration > 0.0 && elapsed >= duration) break;
+        }
+        server.stop();
+
+        std::cout << "Final per-stream statistics:\n";
+        printStats(server.getStats());
+        if (serverConfig.batchInference) printBatcherStats(server.getBatcherStats());
+
+        logger.close();
+        std::cout << "Results logged: " << logger.getWritten()
+                  << ", dropped: " << logger.getDropped() << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif // RUN_MULTISTREAM
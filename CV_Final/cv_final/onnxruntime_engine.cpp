@@ -0,0 +1,104 @@
+/**
+ * onnxruntime_engine.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the ONNX Runtime engine: session setup from InferenceEngineConfig
+ *              and inference through a reused IoBinding.
+ */
+
+#ifdef HAVE_ONNXRUNTIME
+
+#include "onnxruntime_engine.hpp"
+#include "assets.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// One runtime environment per process, shared by all sessions
+static Ort::Env& ortEnv() {
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "emotion");
+    return env;
+}
+
+static GraphOptimizationLevel toOrtLevel(int level) {
+    switch (level) {
+    case 0: return ORT_DISABLE_ALL;
+    case 1: return ORT_ENABLE_BASIC;
+    case 2: return ORT_ENABLE_EXTENDED;
+    default: return ORT_ENABLE_ALL;
+    }
+}
+
+// Constructor: configure threading and graph optimization, create the session once
+OnnxRuntimeEngine::OnnxRuntimeEngine(const std::string& modelPath, const InferenceEngineConfig& config) {
+    if (config.numThreads > 0) options.SetIntraOpNumThreads(config.numThreads);
+    if (config.interOpThreads > 0) options.SetInterOpNumThreads(config.interOpThreads);
+    options.SetGraphOptimizationLevel(toOrtLevel(config.graphOptimizationLevel));
+
+    if (config.precision == InferencePrecision::FP16) {
+        throw std::runtime_error("FP16 is not supported by the ONNX Runtime CPU engine");
+    }
+    if (config.precision == InferencePrecision::INT8 && config.int8ModelPath.empty()) {
+        throw std::runtime_error("ONNX Runtime INT8 needs a quantized model (config::INT8_MODEL_PATH)");
+    }
+    const std::string& path = config.precision == InferencePrecision::INT8 ? config.int8ModelPath : modelPath;
+    if (config.precision != InferencePrecision::FP32) {
+        suffix = std::string("/") + precisionName(config.precision);
+    }
+
+    try {
+        if (const Assets::EmbeddedAsset* embedded = Assets::findEmbedded(path)) {
+            session = Ort::Session(ortEnv(), embedded->data, embedded->size, options);
+        } else {
+            session = Ort::Session(ortEnv(), path.c_str(), options);
+        }
+    } catch (const Ort::Exception& e) {
+        throw std::runtime_error("Failed to load ONNX model from path: " + path + " (" + e.what() + ")");
+    }
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    inputName = session.GetInputNameAllocated(0, allocator).get();
+    outputName = session.GetOutputNameAllocated(0, allocator).get();
+
+    std::vector<int64_t> outputShape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (outputShape.empty() || outputShape.back() <= 0) {
+        throw std::runtime_error("Model output must have a fixed number of classes: " + path);
+    }
+    numClasses = static_cast<int>(outputShape.back());
+
+    memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    binding = Ort::IoBinding(session);
+}
+
+void OnnxRuntimeEngine::bind(const cv::Mat& blob) {
+    const int batch = blob.size[0];
+    if (blob.data == boundData && batch == boundBatch) return;
+
+    // Grow the output buffer if needed (it never shrinks)
+    if (outputBuffer.rows < batch) {
+        outputBuffer.create(batch, numClasses, CV_32F);
+    }
+
+    int64_t inputShape[] = {batch, blob.size[1], blob.size[2], blob.size[3]};
+    int64_t outputShape[] = {batch, numClasses};
+    inputTensor = Ort::Value::CreateTensor<float>(memoryInfo, reinterpret_cast<float*>(blob.data), blob.total(),
+                                                  inputShape, 4);
+    outputTensor = Ort::Value::CreateTensor<float>(memoryInfo, outputBuffer.ptr<float>(),
+                                                   static_cast<size_t>(batch) * numClasses, outputShape, 2);
+
+    binding.ClearBoundInputs();
+    binding.ClearBoundOutputs();
+    binding.BindInput(inputName.c_str(), inputTensor);
+    binding.BindOutput(outputName.c_str(), outputTensor);
+
+    boundData = blob.data;
+    boundBatch = batch;
+}
+
+cv::Mat OnnxRuntimeEngine::infer(const cv::Mat& blob) {
+    bind(blob);
+    session.Run(Ort::RunOptions{nullptr}, binding);
+    return outputBuffer.rowRange(0, boundBatch);
+}
+
+#endif // HAVE_ONNXRUNTIME
@@ -0,0 +1,50 @@
+/**
+ * onnxruntime_engine.hpp
+ * Author: Niloofar Karimi
+ * Description: ONNX Runtime CPU inference engine. The session is created once and inputs and
+ *              outputs are bound directly to caller/engine memory through an IoBinding, which is
+ *              only rebuilt when the batch size or input buffer changes.
+ *              INT8 runs a statically quantized model (config::INT8_MODEL_PATH, e.g. produced by
+ *              onnxruntime.quantization.quantize_static from calibrate's .npy); FP16 is not
+ *              supported by the CPU execution provider.
+ *              Compiled only when HAVE_ONNXRUNTIME is defined (link with -lonnxruntime).
+ */
+
+#pragma once
+
+#ifdef HAVE_ONNXRUNTIME
+
+#include <onnxruntime_cxx_api.h>
+#include <string>
+
+#include "inference_engine.hpp"
+
+class OnnxRuntimeEngine : public InferenceEngine {
+public:
+    OnnxRuntimeEngine(const std::string& modelPath, const InferenceEngineConfig& config);
+
+    cv::Mat infer(const cv::Mat& blob) override;
+    std::string name() const override { return "onnxruntime" + suffix; }
+
+private:
+    // Bind the input tensor to `blob` and the output tensor to outputBuffer
+    void bind(const cv::Mat& blob);
+
+    Ort::SessionOptions options;
+    Ort::Session session{nullptr};
+    Ort::MemoryInfo memoryInfo{nullptr};
+    Ort::IoBinding binding{nullptr};
+    Ort::Value inputTensor{nullptr};
+    Ort::Value outputTensor{nullptr};
+
+    std::string inputName;
+    std::string outputName;
+    int numClasses = 0;
+    std::string suffix;                 // Precision tag appended to name()
+
+    cv::Mat outputBuffer;               // [rows >= batch, numClasses] scores written by Run()
+    const uchar* boundData = nullptr;   // Input buffer the current binding refers to
+    int boundBatch = 0;                 // Batch size of the current binding
+};
+
+#endif // HAVE_ONNXRUNTIME
@@ -0,0 +1,105 @@
+/**
+ * pack.cpp
+ * Author: Niloofar Karimi
+ * Description: Packs a labelled image folder (same layout as batch_test: one subfolder of
+ *              images per emotion) into a single packed dataset file. Every image is decoded,
+ *              histogram-equalized and cropped/resized to the model input once, so repeated
+ *              batch_test runs on the pack skip decoding and directory traversal.
+ *
+ *              u8 packs (default) store 8-bit faces and still support TTA; f32 packs store the
+ *              exact normalized model input.
+ *
+ * Usage: pack <image_dir> [--output test.fpk] [--format u8|f32]
+ */
+
+#ifdef RUN_PACK
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "packed_dataset.hpp"
+
+namespace fs = std::filesystem;
+
+// Print command-line usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <image_dir> [--output test.fpk] [--format u8|f32]\n"
+              << "  image_dir  folder with one subfolder of images per emotion label\n"
+              << "  --output   packed dataset to write (default: test.fpk)\n"
+              << "  --format   u8 (cropped 8-bit faces, default) or f32 (model-ready tensors, no TTA)\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::string imageDir;
+        std::string outputPath = "test.fpk";
+        PackedFormat format = PackedFormat::U8;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "--format" && i + 1 < argc) {
+                format = parsePackedFormat(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (imageDir.empty() && arg.rfind("--", 0) != 0) {
+                imageDir = arg;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (imageDir.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!fs::is_directory(imageDir)) {
+            std::cerr << "Directory '" << imageDir << "' does not exist.\n";
+            return 1;
+        }
+
+        // Same listing and order as batch_test, so CSV rows line up between the two inputs
+        std::vector<fs::path> paths;
+        for (const auto& entry : fs::recursive_directory_iterator(imageDir)) {
+            if (entry.is_regular_file()) paths.push_back(entry.path());
+        }
+        std::sort(paths.begin(), paths.end());
+
+        PackedDatasetWriter writer(outputPath, format, cv::Size(config::INPUT_WIDTH, config::INPUT_HEIGHT));
+        cv::Mat img;
+        for (const auto& path : paths) {
+            img = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
+            if (img.empty()) {
+                std::cerr << "Failed to read image: " << path.string() << std::endl;
+                continue;
+            }
+            cv::equalizeHist(img, img);
+            writer.add(img, path.parent_path().filename().string(),
+                       path.lexically_relative(imageDir).generic_string());
+        }
+        writer.finish();
+
+        if (writer.getCount() == 0) {
+            std::cerr << "No readable images found in '" << imageDir << "'.\n";
+            return 1;
+        }
+        std::cout << "Packed " << writer.getCount() << " of " << paths.size() << " images into " << outputPath
+                  << " (" << fs::file_size(outputPath) / 1024 << " KiB)\n";
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // RUN_PACK
@@ -0,0 +1,221 @@
+/**
+ * packed_dataset.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the packed dataset writer and the memory-mapped reader.
+ */
+
+#include "packed_dataset.hpp"
+#include "preprocess.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char PACK_MAGIC[8] = {'E', 'M', 'O', 'P', 'A', 'C', 'K', '1'};
+
+// Alignment of the tensor section (cache line / widest SIMD load)
+static const uint64_t PACK_ALIGNMENT = 64;
+
+PackedFormat parsePackedFormat(const std::string& name) {
+    if (name == "u8") return PackedFormat::U8;
+    if (name == "f32") return PackedFormat::F32;
+    throw std::invalid_argument("Unknown packed format: " + name + " (expected u8 or f32)");
+}
+
+static size_t bytesPerPixel(PackedFormat format) {
+    return format == PackedFormat::F32 ? sizeof(float) : 1;
+}
+
+// ---- Writer ----
+
+PackedDatasetWriter::PackedDatasetWriter(const std::string& filePath, PackedFormat fmt, const cv::Size& imageSize)
+    : out(filePath, std::ios::binary | std::ios::trunc), path(filePath), format(fmt), size(imageSize) {
+    if (!out) {
+        throw std::runtime_error("Could not create packed dataset: " + path);
+    }
+    tensor.resize(static_cast<size_t>(size.area()));
+
+    // Placeholder header; tensors start at the next aligned offset
+    PackedDatasetHeader header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<char> padding(PACK_ALIGNMENT - sizeof(header) % PACK_ALIGNMENT, 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+}
+
+PackedDatasetWriter::~PackedDatasetWriter() {
+    try {
+        finish();
+    } catch (...) {
+        // Destructors must not throw; call finish() to see write errors
+    }
+}
+
+void PackedDatasetWriter::add(const cv::Mat& faceGray, const std::string& label, const std::string& name) {
+    if (finished) {
+        throw std::runtime_error("Packed dataset already finished: " + path);
+    }
+
+    if (format == PackedFormat::F32) {
+        // Exactly the tensor the classifier would build
+        PreprocessScratch scratch;
+        preprocessInto(faceGray, size, tensor.data(), scratch);
+        out.write(reinterpret_cast<const char*>(tensor.data()), static_cast<std::streamsize>(tensor.size() * sizeof(float)));
+    } else {
+        // Same center crop and bilinear sampling as preprocessInto(), rounded to 8 bits
+        const int side = std::min(faceGray.cols, faceGray.rows);
+        cv::Rect square((faceGray.cols - side) / 2, (faceGray.rows - side) / 2, side, side);
+        cv::resize(faceGray(square), cropped, size, 0, 0, cv::INTER_LINEAR);
+        if (!cropped.isContinuous()) cropped = cropped.clone();
+        out.write(reinterpret_cast<const char*>(cropped.data), static_cast<std::streamsize>(cropped.total()));
+    }
+
+    auto it = std::find(labelNames.begin(), labelNames.end(), label);
+    if (it == labelNames.end()) it = labelNames.insert(labelNames.end(), label);
+    labels.push_back(static_cast<int32_t>(it - labelNames.begin()));
+
+    nameOffsets.push_back(names.size());
+    names.append(name);
+    names.push_back('\0');
+}
+
+void PackedDatasetWriter::finish() {
+    if (finished) return;
+    finished = true;
+
+    PackedDatasetHeader header{};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.format = static_cast<uint32_t>(format);
+    header.count = static_cast<uint32_t>(labels.size());
+    header.width = static_cast<uint32_t>(size.width);
+    header.height = static_cast<uint32_t>(size.height);
+    header.numLabels = static_cast<uint32_t>(labelNames.size());
+    header.tensorOffset = (sizeof(header) / PACK_ALIGNMENT + 1) * PACK_ALIGNMENT;
+
+    uint64_t offset = header.tensorOffset + labels.size() * size.area() * bytesPerPixel(format);
+    header.labelOffset = offset;
+    out.write(reinterpret_cast<const char*>(labels.data()), static_cast<std::streamsize>(labels.size() * sizeof(int32_t)));
+    offset += labels.size() * sizeof(int32_t);
+
+    header.labelNamesOffset = offset;
+    for (const auto& name : labelNames) {
+        out.write(name.c_str(), static_cast<std::streamsize>(name.size() + 1));
+        offset += name.size() + 1;
+    }
+
+    // Keep the 64-bit name index aligned
+    const uint64_t pad = (8 - offset % 8) % 8;
+    const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>(pad));
+    offset += pad;
+
+    header.nameIndexOffset = offset;
+    out.write(reinterpret_cast<const char*>(nameOffsets.data()), static_cast<std::streamsize>(nameOffsets.size() * sizeof(uint64_t)));
+    offset += nameOffsets.size() * sizeof(uint64_t);
+
+    header.namesOffset = offset;
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    offset += names.size();
+    header.fileSize = offset;
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write packed dataset: " + path);
+    }
+}
+
+// ---- Reader ----
+
+bool PackedDataset::isPackedDataset(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(PACK_MAGIC)] = {};
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, PACK_MAGIC, sizeof(magic)) == 0;
+}
+
+PackedDataset::PackedDataset(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open packed dataset: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PackedDatasetHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a packed dataset: " + path);
+    }
+    mappedSize = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map packed dataset: " + path);
+    }
+    data = static_cast<const unsigned char*>(mapping);
+    // Evaluation reads the file front to back
+    ::madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+
+    header = reinterpret_cast<const PackedDatasetHeader*>(data);
+    imageBytes = static_cast<size_t>(header->width) * header->height *
+                 bytesPerPixel(static_cast<PackedFormat>(header->format));
+    const uint64_t count = header->count;
+    const bool valid = std::memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+                       header->format <= static_cast<uint32_t>(PackedFormat::F32) &&
+                       header->fileSize == mappedSize &&
+                       header->tensorOffset % PACK_ALIGNMENT == 0 &&
+                       header->tensorOffset + count * imageBytes <= header->labelOffset &&
+                       header->labelOffset + count * sizeof(int32_t) <= header->labelNamesOffset &&
+                       header->labelNamesOffset <= header->nameIndexOffset &&
+                       header->nameIndexOffset % sizeof(uint64_t) == 0 &&
+                       header->nameIndexOffset + count * sizeof(uint64_t) <= header->namesOffset &&
+                       header->namesOffset <= mappedSize;
+    if (!valid) {
+        ::munmap(mapping, mappedSize);
+        throw std::runtime_error("Corrupt or incompatible packed dataset: " + path);
+    }
+
+    labels = reinterpret_cast<const int32_t*>(data + header->labelOffset);
+    nameIndex = reinterpret_cast<const uint64_t*>(data + header->nameIndexOffset);
+    names = reinterpret_cast<const char*>(data + header->namesOffset);
+
+    const char* label = reinterpret_cast<const char*>(data + header->labelNamesOffset);
+    const char* labelsEnd = reinterpret_cast<const char*>(data + header->nameIndexOffset);
+    for (uint32_t i = 0; i < header->numLabels && label < labelsEnd; ++i) {
+        labelNames.emplace_back(label, strnlen(label, static_cast<size_t>(labelsEnd - label)));
+        label += labelNames.back().size() + 1;
+    }
+    if (labelNames.size() != header->numLabels) {
+        ::munmap(mapping, mappedSize);
+        throw std::runtime_error("Corrupt label table in packed dataset: " + path);
+    }
+
+    // label() and name() index straight into the mapping, so check every entry once here.
+    // Names are NUL-terminated and the file ends with the last one's terminator.
+    const uint64_t namesSize = mappedSize - header->namesOffset;
+    bool entriesValid = count == 0 || (namesSize > 0 && data[mappedSize - 1] == '\0');
+    for (uint64_t i = 0; i < count && entriesValid; ++i) {
+        entriesValid = labels[i] >= -1 && labels[i] < static_cast<int64_t>(header->numLabels) &&
+                       nameIndex[i] < namesSize;
+    }
+    if (!entriesValid) {
+        ::munmap(mapping, mappedSize);
+        throw std::runtime_error("Corrupt label or name entries in packed dataset: " + path);
+    }
+}
+
+PackedDataset::~PackedDataset() {
+    if (data) ::munmap(const_cast<unsigned char*>(data), mappedSize);
+}
+
+cv::Mat PackedDataset::image(size_t index) const {
+    uchar* pixels = const_cast<uchar*>(data + header->tensorOffset + index * imageBytes);
+    return cv::Mat(static_cast<int>(header->height), static_cast<int>(header->width), CV_8UC1, pixels);
+}
+
+const float* PackedDataset::tensor(size_t index) const {
+    return reinterpret_cast<const float*>(data + header->tensorOffset + index * imageBytes);
+}
@@ -0,0 +1,124 @@
+/**
+ * packed_dataset.hpp
+ * Author: Niloofar Karimi
+ * Description: Packed evaluation dataset: one binary file holding every test face already
+ *              decoded, equalized and cropped to the model input size, so repeated
+ *              evaluations skip image decoding and directory traversal entirely.
+ *
+ *              Layout (native little-endian):
+ *                header      PackedDatasetHeader
+ *                tensors     count images of height x width, u8 pixels or f32 model input
+ *                            (normalized to [-1, 1]); starts on a 64-byte boundary
+ *                labels      count int32 indices into the label name table (-1 = none)
+ *                label names numLabels NUL-terminated strings (e.g. the class folder names)
+ *                name index  count uint64 offsets into the name blob
+ *                names       count NUL-terminated file names, relative to the packed folder
+ *
+ *              PackedDatasetWriter streams faces into a file; PackedDataset maps one
+ *              read-only and hands out its images as zero-copy cv::Mat headers or raw tensors.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Pixel format of the packed tensors
+enum class PackedFormat : uint32_t {
+    U8 = 0,     // Cropped and resized 8-bit faces; the classifier still normalizes (and can apply TTA)
+    F32 = 1     // Model-ready normalized tensors, identical to the classifier's preprocessing
+};
+
+// Parse "u8" or "f32" (throws std::invalid_argument otherwise)
+PackedFormat parsePackedFormat(const std::string& name);
+
+// Fixed-size file header
+struct PackedDatasetHeader {
+    char magic[8];              // "EMOPACK1"
+    uint32_t format;            // PackedFormat
+    uint32_t count;             // Number of images
+    uint32_t width, height;     // Image size (the model input size when packed)
+    uint32_t numLabels;         // Entries in the label name table
+    uint32_t reserved;
+    uint64_t tensorOffset, labelOffset, labelNamesOffset, nameIndexOffset, namesOffset;
+    uint64_t fileSize;
+};
+
+// Writes a packed dataset one face at a time
+class PackedDatasetWriter {
+public:
+    // Create `path`; faces are stored at `size` (normally the model input size)
+    PackedDatasetWriter(const std::string& path, PackedFormat format, const cv::Size& size);
+    ~PackedDatasetWriter();
+
+    PackedDatasetWriter(const PackedDatasetWriter&) = delete;
+    PackedDatasetWriter& operator=(const PackedDatasetWriter&) = delete;
+
+    // Append one grayscale face (any size; it is center-cropped and resized like the
+    // classifier does) with its label name and file name
+    void add(const cv::Mat& faceGray, const std::string& label, const std::string& name);
+
+    // Write the tables and the final header (also done by the destructor)
+    void finish();
+
+    size_t getCount() const { return labels.size(); }
+
+private:
+    std::ofstream out;
+    std::string path;
+    PackedFormat format;
+    cv::Size size;
+    bool finished = false;
+
+    std::vector<int32_t> labels;
+    std::vector<std::string> labelNames;
+    std::vector<uint64_t> nameOffsets;
+    std::string names;
+
+    cv::Mat cropped;                  // Reused 8-bit crop
+    std::vector<float> tensor;        // Reused normalized tensor
+};
+
+// Read-only memory mapping of a packed dataset
+class PackedDataset {
+public:
+    // Map `path` and validate its header, tables and every label and name entry
+    // (throws std::runtime_error)
+    explicit PackedDataset(const std::string& path);
+    ~PackedDataset();
+
+    PackedDataset(const PackedDataset&) = delete;
+    PackedDataset& operator=(const PackedDataset&) = delete;
+
+    // True if the file starts with the packed dataset magic
+    static bool isPackedDataset(const std::string& path);
+
+    size_t size() const { return header->count; }
+    PackedFormat format() const { return static_cast<PackedFormat>(header->format); }
+    cv::Size imageSize() const { return cv::Size(static_cast<int>(header->width), static_cast<int>(header->height)); }
+
+    // Image `index` of a U8 dataset as a header over the mapping (do not write to it)
+    cv::Mat image(size_t index) const;
+
+    // Normalized tensor `index` of an F32 dataset (height x width floats)
+    const float* tensor(size_t index) const;
+
+    // Label of image `index`: an index into the label names, or -1 if it has none
+    int label(size_t index) const { return labels[index]; }
+    const std::string& labelName(int label) const { return labelNames[label]; }
+    int labelCount() const { return static_cast<int>(labelNames.size()); }
+    const char* name(size_t index) const { return names + nameIndex[index]; }
+
+private:
+    const unsigned char* data = nullptr;   // Start of the mapping
+    size_t mappedSize = 0;
+    const PackedDatasetHeader* header = nullptr;
+    const int32_t* labels = nullptr;
+    const uint64_t* nameIndex = nullptr;
+    const char* names = nullptr;
+    std::vector<std::string> labelNames;
+    size_t imageBytes = 0;
+};
@@ -0,0 +1,507 @@
+/**
+ * pipeline.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the staged realtime pipeline. Capture, detection and each
+ *              classification worker run on their own threads; the render stage runs on
+ *              the thread that calls run() and receives frames in capture order.
+ */
+
+#include "pipeline.hpp"
+#include "config.hpp"
+#include "utils.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Per-worker state: classification is not thread-safe, so every worker owns its own model
+struct Pipeline::Worker {
+    EmotionClassifier classifier;
+    std::thread thread;
+    std::vector<cv::Mat> freshFaces;                 // Faces classified when others reuse predictions
+    std::vector<size_t> freshIndices;                // Their positions in the frame
+    std::vector<EmotionPrediction> freshPredictions;
+    std::vector<uchar> freshUnstable;
+    std::vector<uchar> freshEscalated;
+    std::vector<ResultCache::Signature> signatures;  // Crop signature per face of the frame
+
+    Worker(const PipelineConfig& config, StartupProfile* startup, int index)
+        : classifier(measureStartup(startup, "model #" + std::to_string(index), [&]() {
+              return EmotionClassifier(config.modelPath, config.engine);
+          })) {
+        classifier.setMaxBatchSize(config.maxBatchSize);
+        classifier.setAdaptiveTta(config.adaptiveTta);
+        if (config.warmUp) {
+            measureStartup(startup, "warm-up #" + std::to_string(index), [&]() { classifier.warmUp(); });
+        }
+    }
+};
+
+// Milliseconds since `start`
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Back off while waiting on an empty queue: yield first, then sleep briefly
+static void backoff(int& spins) {
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+// Number of classification workers when the config leaves it at 0: one per core
+// not already taken by the capture, detect and render threads
+static int defaultWorkerCount() {
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, cores - 3);
+}
+
+static int workerCount(const PipelineConfig& config) {
+    return config.classifyWorkers > 0 ? config.classifyWorkers : defaultWorkerCount();
+}
+
+// Most frames that can be in flight at once: every queue full, one frame per stage thread
+// and the render stage's reorder window (see renderLoop)
+static size_t maxFramesInFlight(const PipelineConfig& config) {
+    size_t workers = static_cast<size_t>(workerCount(config));
+    size_t queues = static_cast<size_t>(config.queueCapacity);
+    return 2 * workers + 6 * queues + 3;
+}
+
+void FrameResult::reset() {
+    gray = cv::Mat();
+    faces.clear();
+    trackIds.clear();
+    angles.clear();
+    alignedFaces.clear();
+    predictions.clear();
+    usedTTA = false;
+    ttaMode = TtaMode::Off;
+    escalated.clear();
+    unstable.clear();
+    reused.clear();
+    quality = QualityLevel::Full;
+    detectMs = 0.0;
+    classifyMs = 0.0;
+    arena.reset();
+}
+
+// Start loading every worker's classifier and the eye cascade, each on its own thread
+Pipeline::PendingLoads Pipeline::startLoads(const PipelineConfig& config, StartupProfile* startup) {
+    PendingLoads pending;
+    int numWorkers = workerCount(config);
+    for (int i = 0; i < numWorkers; ++i) {
+        pending.workers.push_back(std::async(std::launch::async, [&config, startup, i]() {
+            return std::make_unique<Worker>(config, startup, i);
+        }));
+    }
+    pending.aligner = std::async(std::launch::async, [&config, startup]() {
+        return measureStartup(startup, "eye cascade", [&]() { return FaceAligner(config.eyeCascadePath); });
+    });
+    return pending;
+}
+
+Pipeline::Pipeline(const PipelineConfig& cfg, StartupProfile* startup)
+    : Pipeline(cfg, startup, startLoads(cfg, startup)) {}
+
+// Constructor: load the face detector here while the other loads finish, then collect them.
+// A failed load is rethrown once every load has finished.
+Pipeline::Pipeline(const PipelineConfig& cfg, StartupProfile* startup, PendingLoads pending)
+    : config(cfg),
+      detector(measureStartup(startup, "face cascade", [&]() { return FaceDetector(cfg.faceCascadePath); })),
+      tracker(detector),
+      aligner(pending.aligner.get()),
+      framePool(maxFramesInFlight(cfg)),
+      quality(cfg.quality, workerCount(cfg)),
+      fullDetectWidth(detector.getMaxDetectWidth()),
+      lowResDetectWidth(fullDetectWidth > 0 ? std::min(fullDetectWidth, cfg.lowResDetectWidth) : cfg.lowResDetectWidth),
+      captureQueue(static_cast<size_t>(cfg.queueCapacity)),
+      detectQueue(static_cast<size_t>(cfg.queueCapacity)),
+      resultQueue(static_cast<size_t>(cfg.queueCapacity)),
+      droppedQueue(1024),
+      resultCache(cfg.cache) {
+
+    for (auto& worker : pending.workers) {
+        workers.push_back(worker.get());
+    }
+}
+
+Pipeline::~Pipeline() {
+    stop();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+void Pipeline::stop() {
+    running.store(false);
+}
+
+PipelineStats Pipeline::getStats() const {
+    PipelineStats stats;
+    stats.captured = capturedCount.load();
+    stats.dropped = droppedCount.load();
+    stats.rendered = renderedCount.load();
+    stats.adaptiveFaces = adaptiveCount.load();
+    stats.escalatedFaces = escalatedCount.load();
+    stats.shed = shedCount.load();
+    stats.reusedFaces = reusedCount.load();
+    stats.cacheLookups = resultCache.getLookups();
+    stats.cacheHits = resultCache.getHits();
+    return stats;
+}
+
+void Pipeline::setUnstableTracks(const std::vector<int>& trackIds) {
+    std::lock_guard<std::mutex> lock(unstableMutex);
+    unstableTracks.assign(trackIds.begin(), trackIds.end());
+    std::sort(unstableTracks.begin(), unstableTracks.end());
+}
+
+void Pipeline::markUnstable(FrameResult& task) {
+    std::lock_guard<std::mutex> lock(unstableMutex);
+    task.unstable.resize(task.trackIds.size());
+    for (size_t i = 0; i < task.trackIds.size(); ++i) {
+        task.unstable[i] = std::binary_search(unstableTracks.begin(), unstableTracks.end(), task.trackIds[i]) ? 1 : 0;
+    }
+}
+
+void Pipeline::pushOrDrop(BoundedQueue<Task>& queue, Task task) {
+    if (!config.dropFrames) {
+        int spins = 0;
+        while (!queue.tryPush(std::move(task))) {
+            if (!running.load()) {
+                droppedCount.fetch_add(1);
+                framePool.release(std::move(task));
+                return;
+            }
+            backoff(spins);
+        }
+        return;
+    }
+
+    queue.pushDropOldest(std::move(task), [this](Task& dropped) {
+        droppedCount.fetch_add(1);
+        uint64_t index = dropped->index;
+        droppedQueue.tryPush(std::move(index));
+        framePool.release(std::move(dropped));
+    });
+}
+
+// Start all stage threads and run the render stage on the calling thread
+void Pipeline::run(FrameSource source, FrameSink sink) {
+    running.store(true);
+    captureDone.store(false);
+    detectDone.store(false);
+    activeWorkers.store(static_cast<int>(workers.size()));
+
+    // Wrap a stage so an exception stops the whole pipeline and is rethrown from run()
+    auto guarded = [this](auto body) {
+        return [this, body]() mutable {
+            try {
+                body();
+            } catch (...) {
+                if (!hasError.exchange(true)) error = std::current_exception();
+                running.store(false);
+            }
+        };
+    };
+
+    std::thread captureThread(guarded([this, &source]() { captureLoop(source); }));
+    std::thread detectThread(guarded([this]() { detectLoop(); }));
+    for (auto& worker : workers) {
+        Worker* w = worker.get();
+        worker->thread = std::thread(guarded([this, w]() { classifyLoop(*w); }));
+    }
+
+    try {
+        renderLoop(sink);
+    } catch (...) {
+        if (!hasError.exchange(true)) error = std::current_exception();
+    }
+    running.store(false);
+
+    captureThread.join();
+    detectThread.join();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+
+    if (hasError.load()) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Capture stage: read frames from the source and hand them to detection
+void Pipeline::captureLoop(FrameSource& source) {
+    uint64_t index = 0;
+    bool shedToggle = false;
+    while (running.load()) {
+        Task task = framePool.acquire();
+        task->reset();
+        {
+            PROFILE_SCOPE(Capture);
+            if (!source(task->frame) || task->frame.empty()) break;
+        }
+        task->captureTime = std::chrono::steady_clock::now();
+
+        // Load shedding: drop every other frame before it costs anything downstream
+        if (getQualityLevel() == QualityLevel::DropFrames && (shedToggle = !shedToggle)) {
+            shedCount.fetch_add(1);
+            framePool.release(std::move(task));
+            continue;
+        }
+
+        task->index = index++;
+        capturedCount.fetch_add(1);
+        pushOrDrop(captureQueue, std::move(task));
+    }
+    captureDone.store(true);
+}
+
+// Detect stage: grayscale conversion (none for luma frames), Haar face detection (or tracking between keyframes)
+// and the rotation angle of every face
+void Pipeline::detectLoop() {
+    int spins = 0;
+    while (running.load()) {
+        bool finished = captureDone.load();
+        Task task;
+        if (!captureQueue.tryPop(task)) {
+            if (finished) break;
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        // Quality level for the rest of this frame's journey
+        task->quality = getQualityLevel();
+        const int detectWidth = task->quality >= QualityLevel::LowResDetect ? lowResDetectWidth : fullDetectWidth;
+        if (detector.getMaxDetectWidth() != detectWidth) {
+            detector.setMaxDetectWidth(detectWidth);
+        }
+
+        {
+            PROFILE_SCOPE(Grayscale);
+            if (task->frame.type() == CV_8UC1) {
+                // Luma ingest: the frame already is the detection image
+                task->gray = task->frame;
+            } else {
+                task->gray = task->arena.mat(task->frame.size(), CV_8UC1);
+                Utils::toGrayscale(task->frame, task->gray);
+            }
+        }
+
+        {
+            PROFILE_SCOPE(Detect);
+            if (config.useTracking) {
+                for (const auto& track : tracker.update(task->gray)) {
+                    task->faces.push_back(track.box);
+                    task->trackIds.push_back(track.id);
+                }
+            } else {
+                const std::vector<cv::Rect> detections = detector.detect(task->gray);
+                task->faces.assign(detections.begin(), detections.end());
+                task->trackIds.assign(task->faces.size(), -1);
+            }
+        }
+        if (task->quality >= QualityLevel::NoAlignment) {
+            task->angles.assign(task->faces.size(), 0.0);
+        } else {
+            PROFILE_SCOPE(Align);
+            aligner.estimateAngles(task->gray, task->faces, task->trackIds, task->angles);
+        }
+        task->ttaMode = task->quality >= QualityLevel::NoTta ? TtaMode::Off : ttaMode.load();
+        task->usedTTA = task->ttaMode == TtaMode::On;
+        task->detectMs = millisSince(start);
+        pushOrDrop(detectQueue, std::move(task));
+    }
+    detectDone.store(true);
+}
+
+// Classify stage (one per worker): warp every face to the model input using its angle and
+// classify them in one batch
+void Pipeline::classifyLoop(Worker& worker) {
+    // Count this worker out on every exit, including an exception, so the render stage ends
+    struct ActiveWorker {
+        std::atomic<int>& count;
+        ~ActiveWorker() { count.fetch_sub(1); }
+    } active{activeWorkers};
+
+    int spins = 0;
+    while (running.load()) {
+        bool finished = detectDone.load();
+        Task task;
+        if (!detectQueue.tryPop(task)) {
+            if (finished) break;
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        const cv::Size inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT);
+        const size_t count = task->faces.size();
+        task->alignedFaces.resize(count);
+        task->predictions.resize(count);
+        task->reused.assign(count, 0);
+        task->escalated.assign(count, 0);
+        markUnstable(*task);
+
+        // Tracked faces reuse their last prediction when the crop is unchanged, or, when
+        // shedding load, whenever the track is stable (skipping the warp as well)
+        const bool reuseStable = task->quality >= QualityLevel::ReuseStable;
+        const bool cacheable = resultCache.isEnabled() || quality.isEnabled();
+        worker.signatures.resize(count);
+        worker.freshFaces.clear();
+        worker.freshIndices.clear();
+        worker.freshUnstable.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const int id = task->trackIds[i];
+            if (reuseStable && id >= 0 && !task->unstable[i] &&
+                resultCache.lookup(id, task->index, nullptr, config.reuseMaxAge, task->predictions[i])) {
+                task->reused[i] = 1;
+                continue;
+            }
+            {
+                PROFILE_SCOPE(Align);
+                task->alignedFaces[i] = task->arena.mat(inputSize, CV_8UC1);
+                alignCrop(task->gray, task->faces[i], task->angles[i], inputSize, task->alignedFaces[i]);
+            }
+            if (cacheable && id >= 0) {
+                ResultCache::computeSignature(task->alignedFaces[i], worker.signatures[i]);
+                if (resultCache.isEnabled() &&
+                    resultCache.lookup(id, task->index, worker.signatures[i], task->predictions[i])) {
+                    task->reused[i] = 1;
+                    continue;
+                }
+            }
+            worker.freshFaces.push_back(task->alignedFaces[i]);
+            worker.freshIndices.push_back(i);
+            worker.freshUnstable.push_back(task->unstable[i]);
+        }
+
+        // Classify the remaining faces with the frame's TTA mode
+        if (task->ttaMode == TtaMode::Adaptive) {
+            int escalated = worker.classifier.classifyAdaptive(worker.freshFaces, worker.freshPredictions,
+                                                               worker.freshEscalated, &worker.freshUnstable);
+            adaptiveCount.fetch_add(worker.freshFaces.size());
+            escalatedCount.fetch_add(static_cast<uint64_t>(escalated));
+        } else {
+            worker.classifier.classifyBatch(worker.freshFaces, task->usedTTA, worker.freshPredictions);
+            worker.freshEscalated.assign(worker.freshFaces.size(), 0);
+        }
+        for (size_t k = 0; k < worker.freshIndices.size(); ++k) {
+            const size_t i = worker.freshIndices[k];
+            task->predictions[i] = worker.freshPredictions[k];
+            task->escalated[i] = worker.freshEscalated[k];
+            if (cacheable && task->trackIds[i] >= 0) {
+                resultCache.store(task->trackIds[i], task->index, worker.signatures[i], task->predictions[i]);
+            }
+        }
+        worker.freshFaces.clear();   // Do not keep arena crops referenced past the frame
+        reusedCount.fetch_add(count - worker.freshIndices.size());
+
+        task->classifyMs = millisSince(start);
+        pushOrDrop(resultQueue, std::move(task));
+    }
+}
+
+// Render stage: reassemble frames in capture order, skipping dropped ones, and pass
+// each to the sink. Stops when the sink returns false, a stage fails or every worker has finished.
+// Both reorder lists are sorted vectors reserved up front, so reassembly allocates nothing.
+void Pipeline::renderLoop(FrameSink& sink) {
+    std::vector<Task> pending;          // Finished frames waiting for earlier ones, by index
+    std::vector<uint64_t> skipped;      // Frames known to have been dropped upstream, sorted
+    pending.reserve(maxFramesInFlight(config));
+    skipped.reserve(1024);
+    uint64_t nextIndex = 0;
+    double lastRenderMs = 0.0;          // Cost of the previous sink call
+    const size_t maxPending = workers.size() + 3 * static_cast<size_t>(config.queueCapacity);
+    int spins = 0;
+
+    auto byIndex = [](const Task& task, uint64_t index) { return task->index < index; };
+
+    while (true) {
+        bool finished = activeWorkers.load() == 0;
+        bool progressed = false;
+
+        uint64_t droppedIndex;
+        while (droppedQueue.tryPop(droppedIndex)) {
+            if (droppedIndex < nextIndex) continue;
+            auto at = std::lower_bound(skipped.begin(), skipped.end(), droppedIndex);
+            if (at == skipped.end() || *at != droppedIndex) skipped.insert(at, droppedIndex);
+        }
+
+        Task task;
+        while (resultQueue.tryPop(task)) {
+            auto at = std::lower_bound(pending.begin(), pending.end(), task->index, byIndex);
+            pending.insert(at, std::move(task));
+            progressed = true;
+        }
+
+        if (!running.load()) {
+            // After a stage failure nothing more is delivered; run() rethrows the error
+            if (finished || hasError.load()) break;
+            backoff(spins);
+            continue;
+        }
+
+        // If a gap never resolves (e.g. a lost drop notice) or all workers are done,
+        // move on to the oldest finished frame
+        if (!pending.empty() && ((config.dropFrames && pending.size() > maxPending) ||
+                                 (finished && resultQueue.emptyApprox()))) {
+            nextIndex = std::max(nextIndex, pending.front()->index);
+        }
+
+        // Deliver every frame that is next in order
+        while (true) {
+            while (!skipped.empty() && skipped.front() < nextIndex) skipped.erase(skipped.begin());
+            if (!skipped.empty() && skipped.front() == nextIndex) {
+                skipped.erase(skipped.begin());
+                ++nextIndex;
+                continue;
+            }
+            // A frame finishing after the render stage moved past it is recycled unseen
+            while (!pending.empty() && pending.front()->index < nextIndex) {
+                framePool.release(std::move(pending.front()));
+                pending.erase(pending.begin());
+            }
+            if (pending.empty() || pending.front()->index != nextIndex) break;
+
+            Task ready = std::move(pending.front());
+            pending.erase(pending.begin());
+            ++nextIndex;
+            renderedCount.fetch_add(1);
+            progressed = true;
+
+            // Feed this frame's stage costs to load shedding; the next frames pick up the level
+            FrameCosts costs;
+            costs.detectMs = ready->detectMs;
+            costs.classifyMs = ready->classifyMs;
+            costs.renderMs = lastRenderMs;
+            costs.latencyMs = millisSince(ready->captureTime);
+            if (quality.observe(costs)) {
+                qualityLevel.store(static_cast<int>(quality.getLevel()));
+            }
+
+            const auto renderStart = std::chrono::steady_clock::now();
+            bool keepGoing = sink(*ready);
+            lastRenderMs = millisSince(renderStart);
+            framePool.release(std::move(ready));
+            if (!keepGoing) {
+                running.store(false);
+                break;
+            }
+        }
+
+        if (finished && pending.empty() && resultQueue.emptyApprox()) break;
+        if (progressed) {
+            spins = 0;
+        } else {
+            backoff(spins);
+        }
+    }
+}
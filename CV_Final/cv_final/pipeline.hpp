@@ -0,0 +1,194 @@
+/**
+ * pipeline.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the Pipeline class.
+ *              Runs capture → detect → classify → render as overlapping stages connected
+ *              by bounded lock-free queues. Classification runs on a pool of workers, each
+ *              with its own model. Results are reassembled in frame order before being
+ *              handed to the render callback.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "emotion_classifier.hpp"
+#include "face_aligner.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_arena.hpp"
+#include "quality_controller.hpp"
+#include "result_cache.hpp"
+#include "startup_profile.hpp"
+
+// Settings for the realtime pipeline
+struct PipelineConfig {
+    std::string modelPath;
+    std::string faceCascadePath;
+    std::string eyeCascadePath;
+    InferenceEngineConfig engine;  // Inference backend used by every classify worker
+    int classifyWorkers = 0;     // 0 = derive from std::thread::hardware_concurrency()
+    int queueCapacity = 4;       // Capacity of each inter-stage queue
+    int maxBatchSize = 32;       // Max images per forward pass in each worker
+    AdaptiveTtaConfig adaptiveTta; // Escalation thresholds and per-frame budget (TtaMode::Adaptive)
+    QualityControllerConfig quality; // Load shedding (enable for live sources)
+    ResultCacheConfig cache;     // Reuse of predictions for unchanged face crops
+    int lowResDetectWidth = 480; // Detection width limit at QualityLevel::LowResDetect
+    int reuseMaxAge = 10;        // Frames a stable track may reuse its prediction (QualityLevel::ReuseStable)
+    bool useTracking = true;     // Track faces between keyframes instead of detecting every frame
+    bool dropFrames = true;      // Drop the oldest queued frame when a stage falls behind (live
+                                 // sources); false waits for space so every frame is processed
+    bool warmUp = true;          // Run each worker's model once on dummy input before the first frame
+};
+
+// A frame travelling through the pipeline. Frames are recycled: reset() keeps the frame
+// buffer and the capacity of every vector, and rewinds the arena holding the per-frame images.
+struct FrameResult {
+    uint64_t index = 0;                          // Capture order (0-based)
+    std::chrono::steady_clock::time_point captureTime;  // When the frame was read
+    cv::Mat frame;                               // Original frame: BGR, or the Y plane (luma ingest)
+    cv::Mat gray;                                // Grayscale frame used for detection (arena, or
+                                                 // the frame itself when it is already gray)
+    std::vector<cv::Rect> faces;                 // Detected face boxes
+    std::vector<int> trackIds;                   // Stable track ID per face (-1 without tracking)
+    std::vector<double> angles;                  // In-plane rotation per face (degrees)
+    std::vector<cv::Mat> alignedFaces;           // Model-input crop per face (arena)
+    std::vector<EmotionPrediction> predictions;  // One prediction per face
+    bool usedTTA = false;                        // Whether TTA was applied to every face of this frame
+    TtaMode ttaMode = TtaMode::Off;              // TTA mode when the frame was classified
+    std::vector<uchar> escalated;                // Adaptive TTA: faces rerun with the variants
+    std::vector<uchar> unstable;                 // Adaptive TTA / reuse: faces whose track is flickering
+    std::vector<uchar> reused;                   // Faces that reused their track's cached prediction
+    QualityLevel quality = QualityLevel::Full;   // Load-shedding level the frame was processed at
+    double detectMs = 0.0;                       // Time spent in the detect stage
+    double classifyMs = 0.0;                     // Time spent in the classify stage
+    FrameArena arena;                            // Backing memory for gray and alignedFaces
+
+    // Prepare for the next frame without releasing any memory
+    void reset();
+};
+
+// Frame counters reported by the pipeline
+struct PipelineStats {
+    uint64_t captured = 0;   // Frames read from the source
+    uint64_t dropped = 0;    // Frames discarded because a stage fell behind
+    uint64_t rendered = 0;   // Frames delivered to the render callback
+    uint64_t adaptiveFaces = 0;    // Faces classified in adaptive TTA mode
+    uint64_t escalatedFaces = 0;   // ...of which were escalated to the TTA variants
+    uint64_t shed = 0;       // Frames dropped by load shedding (QualityLevel::DropFrames)
+    uint64_t reusedFaces = 0;      // Faces that reused a cached prediction (unchanged crop or shedding)
+    uint64_t cacheLookups = 0;     // Tracked faces checked against the result cache
+    uint64_t cacheHits = 0;        // ...whose crop was unchanged, so inference was skipped
+};
+
+class Pipeline {
+public:
+    // Produces the next frame; returns false when the source is exhausted
+    using FrameSource = std::function<bool(cv::Mat&)>;
+    // Consumes a finished frame (in capture order); returns false to stop the pipeline
+    using FrameSink = std::function<bool(FrameResult&)>;
+
+    // Constructor: loads one classifier per worker (in parallel, each on its own thread), the
+    // face detector and the eye cascade. Each phase is recorded in `startup` if given.
+    explicit Pipeline(const PipelineConfig& config, StartupProfile* startup = nullptr);
+    ~Pipeline();
+
+    // Run until the source ends, the sink returns false or stop() is called.
+    // The sink is invoked on the calling thread, so it may use HighGUI.
+    void run(FrameSource source, FrameSink sink);
+
+    // Request the pipeline to stop (safe to call from any thread)
+    void stop();
+
+    // TTA mode for frames entering the classify stage
+    void setTtaMode(TtaMode mode) { ttaMode.store(mode); }
+    TtaMode getTtaMode() const { return ttaMode.load(); }
+
+    // Enable or disable TTA on every face (On / Off)
+    void setUseTTA(bool enabled) { setTtaMode(enabled ? TtaMode::On : TtaMode::Off); }
+    bool getUseTTA() const { return getTtaMode() == TtaMode::On; }
+
+    // Tracks whose displayed emotion is unstable (e.g. from EmotionSmoother::isUnstable).
+    // Adaptive TTA spends its per-frame budget on their faces first. Safe from any thread.
+    void setUnstableTracks(const std::vector<int>& trackIds);
+
+    PipelineStats getStats() const;
+
+    // Current load-shedding level
+    QualityLevel getQualityLevel() const { return static_cast<QualityLevel>(qualityLevel.load()); }
+
+    // Load-shedding controller with its smoothed costs; only read it from the render callback
+    const QualityController& getQualityController() const { return quality; }
+
+private:
+    using Task = std::unique_ptr<FrameResult>;
+    struct Worker;
+
+    // Workers and the eye cascade loading on other threads while the constructor loads the
+    // face cascade
+    struct PendingLoads {
+        std::vector<std::future<std::unique_ptr<Worker>>> workers;
+        std::future<FaceAligner> aligner;
+    };
+    static PendingLoads startLoads(const PipelineConfig& config, StartupProfile* startup);
+    Pipeline(const PipelineConfig& config, StartupProfile* startup, PendingLoads pending);
+
+    void captureLoop(FrameSource& source);
+    void detectLoop();
+    void classifyLoop(Worker& worker);
+    void renderLoop(FrameSink& sink);
+
+    // Flag the task's faces whose track is in unstableTracks
+    void markUnstable(FrameResult& task);
+
+    // Push a task downstream. If the queue is full, drop the oldest queued frame, or with
+    // config.dropFrames off wait for space (dropping only once the pipeline is stopping).
+    // Dropped frames go back to the frame pool.
+    void pushOrDrop(BoundedQueue<Task>& queue, Task task);
+
+    PipelineConfig config;
+    FaceDetector detector;
+    FaceTracker tracker;                  // Only used by the detect stage
+    FaceAligner aligner;                  // Only used by the detect stage
+    std::vector<std::unique_ptr<Worker>> workers;
+    ObjectPool<FrameResult> framePool;    // Frames recycled from render (and drops) to capture
+    QualityController quality;            // Only used by the render stage
+    int fullDetectWidth;                  // Detection width limit outside LowResDetect
+    int lowResDetectWidth;
+
+    BoundedQueue<Task> captureQueue;      // capture → detect
+    BoundedQueue<Task> detectQueue;       // detect → classify
+    BoundedQueue<Task> resultQueue;       // classify → render
+    BoundedQueue<uint64_t> droppedQueue;  // Indices of dropped frames, used by reassembly
+
+    std::atomic<bool> running{false};
+    std::atomic<TtaMode> ttaMode{TtaMode::Off};
+    std::mutex unstableMutex;
+    std::vector<int> unstableTracks;      // Sorted; written by render, read by classify workers
+    std::atomic<int> qualityLevel{0};     // QualityLevel chosen by the render stage
+    ResultCache resultCache;              // Last prediction per track, shared by the workers
+    std::atomic<bool> captureDone{false};
+    std::atomic<bool> detectDone{false};
+    std::atomic<int> activeWorkers{0};
+
+    std::atomic<uint64_t> capturedCount{0};
+    std::atomic<uint64_t> droppedCount{0};
+    std::atomic<uint64_t> renderedCount{0};
+    std::atomic<uint64_t> adaptiveCount{0};
+    std::atomic<uint64_t> escalatedCount{0};
+    std::atomic<uint64_t> shedCount{0};
+    std::atomic<uint64_t> reusedCount{0};
+
+    std::exception_ptr error;             // First exception thrown by a stage thread
+    std::atomic<bool> hasError{false};
+};
@@ -0,0 +1,134 @@
+/**
+ * preprocess.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the fused crop + resize + normalize kernel. Horizontal
+ *              interpolation uses precomputed column tables; the vertical blend and the
+ *              [-1, 1] normalization are folded into one fused multiply-add per pixel and
+ *              vectorized with OpenCV universal intrinsics.
+ */
+
+#include "preprocess.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Pixel normalization: (v / 255 - 0.5) / 0.5 == v * NORM_SCALE + NORM_BIAS
+static const float NORM_SCALE = 2.0f / 255.0f;
+static const float NORM_BIAS = -1.0f;
+
+// Source coordinate and weight for output index `i` (INTER_LINEAR half-pixel mapping)
+static void linearCoord(int i, double scale, int srcLen, int& i0, int& i1, float& alpha) {
+    double f = (i + 0.5) * scale - 0.5;
+    int s = static_cast<int>(std::floor(f));
+    float a = static_cast<float>(f - s);
+    if (s < 0) {
+        s = 0;
+        a = 0.0f;
+    }
+    if (s >= srcLen - 1) {
+        s = srcLen - 1;
+        a = 0.0f;
+    }
+    i0 = s;
+    i1 = std::min(s + 1, srcLen - 1);
+    alpha = a;
+}
+
+// Interpolate one source row horizontally using the column tables
+static void interpolateRow(const uchar* src, const PreprocessScratch& scratch, float* out, int width) {
+    const int* x0 = scratch.xofs0.data();
+    const int* x1 = scratch.xofs1.data();
+    const float* ax = scratch.xalpha.data();
+    for (int x = 0; x < width; ++x) {
+        float left = src[x0[x]];
+        out[x] = left + (src[x1[x]] - left) * ax[x];
+    }
+}
+
+// Blend two interpolated rows and normalize: out = top * w0 + bottom * w1 + NORM_BIAS,
+// where w0 / w1 already include NORM_SCALE
+static void blendRows(const float* top, const float* bottom, float w0, float w1, float* out, int width) {
+    int x = 0;
+#if CV_SIMD
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 8)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+#else
+    const int lanes = cv::v_float32::nlanes;   // Intrinsics API before OpenCV 4.8
+#endif
+    const cv::v_float32 vw0 = cv::vx_setall_f32(w0);
+    const cv::v_float32 vw1 = cv::vx_setall_f32(w1);
+    const cv::v_float32 vbias = cv::vx_setall_f32(NORM_BIAS);
+    for (; x <= width - lanes; x += lanes) {
+        cv::v_float32 acc = cv::v_fma(cv::vx_load(bottom + x), vw1, vbias);
+        cv::v_store(out + x, cv::v_fma(cv::vx_load(top + x), vw0, acc));
+    }
+    cv::vx_cleanup();
+#endif
+    for (; x < width; ++x) {
+        out[x] = top[x] * w0 + bottom[x] * w1 + NORM_BIAS;
+    }
+}
+
+void preprocessInto(const cv::Mat& faceROI, const cv::Size& targetSize, float* dst,
+                    PreprocessScratch& scratch, bool mirror) {
+    CV_Assert(!faceROI.empty() && faceROI.channels() == 1);
+
+    // The kernel reads 8-bit pixels; other depths are converted once into scratch
+    const cv::Mat* input = &faceROI;
+    if (faceROI.depth() != CV_8U) {
+        faceROI.convertTo(scratch.converted, CV_8U);
+        input = &scratch.converted;
+    }
+
+    // Center crop (no copy: only offsets into the source)
+    const int cropSize = std::min(input->rows, input->cols);
+    const int offsetX = (input->cols - cropSize) / 2;
+    const int offsetY = (input->rows - cropSize) / 2;
+
+    const int dstW = targetSize.width;
+    const int dstH = targetSize.height;
+    const double scaleX = static_cast<double>(cropSize) / dstW;
+    const double scaleY = static_cast<double>(cropSize) / dstH;
+
+    // Column tables; a horizontal flip only mirrors the table
+    scratch.xofs0.resize(dstW);
+    scratch.xofs1.resize(dstW);
+    scratch.xalpha.resize(dstW);
+    scratch.rowTop.resize(dstW);
+    scratch.rowBottom.resize(dstW);
+    for (int x = 0; x < dstW; ++x) {
+        int x0, x1;
+        float alpha;
+        linearCoord(x, scaleX, cropSize, x0, x1, alpha);
+        int slot = mirror ? dstW - 1 - x : x;
+        scratch.xofs0[slot] = offsetX + x0;
+        scratch.xofs1[slot] = offsetX + x1;
+        scratch.xalpha[slot] = alpha;
+    }
+
+    int cachedTop = -1, cachedBottom = -1;
+    for (int y = 0; y < dstH; ++y) {
+        int y0, y1;
+        float beta;
+        linearCoord(y, scaleY, cropSize, y0, y1, beta);
+
+        // Reuse interpolated rows shared with the previous output row (upscaling)
+        if (y0 != cachedTop) {
+            if (y0 == cachedBottom) {
+                std::swap(scratch.rowTop, scratch.rowBottom);
+                cachedBottom = -1;
+            } else {
+                interpolateRow(input->ptr<uchar>(offsetY + y0), scratch, scratch.rowTop.data(), dstW);
+            }
+            cachedTop = y0;
+        }
+        if (y1 != cachedBottom) {
+            interpolateRow(input->ptr<uchar>(offsetY + y1), scratch, scratch.rowBottom.data(), dstW);
+            cachedBottom = y1;
+        }
+
+        blendRows(scratch.rowTop.data(), scratch.rowBottom.data(),
+                  (1.0f - beta) * NORM_SCALE, beta * NORM_SCALE, dst + static_cast<size_t>(y) * dstW, dstW);
+    }
+}
@@ -0,0 +1,31 @@
+/**
+ * preprocess.hpp
+ * Author: Niloofar Karimi
+ * Description: Fused preprocessing for the emotion model. Center-crops a grayscale face,
+ *              resizes it bilinearly and normalizes it to [-1, 1] in a single pass, writing
+ *              straight into a slot of a preallocated input tensor.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+
+// Reusable buffers for preprocessInto(); keep one per thread (e.g. one per classifier) so
+// steady-state preprocessing does not allocate
+struct PreprocessScratch {
+    std::vector<int> xofs0, xofs1;     // Left/right source column per output column
+    std::vector<float> xalpha;         // Weight of the right column per output column
+    std::vector<float> rowTop, rowBottom;  // Horizontally interpolated source rows
+    cv::Mat converted;                 // 8-bit copy for non-CV_8UC1 inputs
+};
+
+// Center-crop `faceROI` to a square, resize it to `targetSize` (bilinear, same sampling as
+// cv::resize with INTER_LINEAR) and normalize to [-1, 1], writing targetSize.area() floats
+// to `dst` in row-major order. With `mirror`, the output is flipped horizontally.
+void preprocessInto(const cv::Mat& faceROI, const cv::Size& targetSize, float* dst,
+                    PreprocessScratch& scratch, bool mirror = false);
+
+// Pointer to image slot `index` of a [N, H, W, 1] float input tensor
+inline float* batchSlot(cv::Mat& blob, int index) {
+    return blob.ptr<float>() + static_cast<size_t>(index) * blob.size[1] * blob.size[2] * blob.size[3];
+}
@@ -0,0 +1,297 @@
+/**
+ * profiler.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the per-thread latency histograms and the periodic report.
+ *              Values are bucketed in microseconds with 16 linear sub-buckets per power of
+ *              two (about 6% relative precision), covering 1 us to over an hour.
+ */
+
+#ifdef ENABLE_PROFILING
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace Profiler {
+
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int EXPONENTS = 32;
+    static const int NUM_BUCKETS = EXPONENTS * SUB_BUCKETS;
+    static const int NUM_STAGES = static_cast<int>(Stage::Count);
+    static const int MAX_SCOPE_DEPTH = 16;
+
+    // Bucket index of a value in microseconds
+    static int bucketOf(uint64_t us) {
+        if (us < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<int>(us);
+        int msb = 63 - __builtin_clzll(us);
+        int exponent = msb - SUB_BUCKET_BITS + 1;
+        int sub = static_cast<int>(us >> (exponent - 1)) - SUB_BUCKETS;
+        int index = exponent * SUB_BUCKETS + sub;
+        return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+    }
+
+    // Representative value (microseconds) of a bucket: its midpoint
+    static double bucketValue(int index) {
+        int exponent = index / SUB_BUCKETS;
+        int sub = index % SUB_BUCKETS;
+        if (exponent == 0) return sub;
+        double width = static_cast<double>(1ULL << (exponent - 1));
+        return (SUB_BUCKETS + sub) * width + width / 2.0;
+    }
+
+    // Histograms owned by one thread. Only the owner increments the counters; the flusher
+    // reads them, so relaxed atomics are enough and recording never blocks.
+    struct ThreadHistograms {
+        std::array<std::array<std::atomic<uint64_t>, NUM_BUCKETS>, NUM_STAGES> counts{};
+        std::array<std::atomic<uint64_t>, NUM_STAGES> maxUs{};
+
+        // Allocation attribution (countAllocations); the plain fields are owner-only
+        std::atomic<const std::atomic<uint64_t>*> allocationCounter{nullptr};
+        std::array<std::atomic<uint64_t>, NUM_STAGES> allocations{};
+        std::atomic<uint64_t> allocationsOutside{0};
+        int depth = 0;                                // Open scopes
+        uint64_t nested[MAX_SCOPE_DEPTH] = {};        // Allocations of scopes nested in each open one
+        uint64_t outsideMark = 0;                     // Allocation count when the last scope closed
+    };
+
+    static std::atomic<AllocationCounter> allocationCounterOf{nullptr};
+
+    // Add to a counter only its owning thread writes
+    static void addRelaxed(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Registry of all thread histograms plus the state of the reporter
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadHistograms>> threads;   // Never shrinks
+        std::array<std::array<uint64_t, NUM_BUCKETS>, NUM_STAGES> lastCounts{};
+        std::ofstream out;
+        bool json = false;
+        double flushIntervalSec = 1.0;
+        std::chrono::steady_clock::time_point lastFlush = std::chrono::steady_clock::now();
+        Summary latest;
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    // Histograms of the calling thread, registered on first use
+    static ThreadHistograms& localHistograms() {
+        thread_local ThreadHistograms* local = nullptr;
+        if (!local) {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.threads.push_back(std::make_unique<ThreadHistograms>());
+            local = reg.threads.back().get();
+        }
+        return *local;
+    }
+
+    const char* stageName(Stage stage) {
+        static const char* names[] = {
+            "capture", "grayscale", "detect", "align", "preprocess", "forward", "smoothing", "render", "frame"
+        };
+        int index = static_cast<int>(stage);
+        return index >= 0 && index < NUM_STAGES ? names[index] : "unknown";
+    }
+
+    void record(Stage stage, int64_t nanoseconds) {
+        ThreadHistograms& hist = localHistograms();
+        uint64_t us = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds / 1000) : 0;
+        int s = static_cast<int>(stage);
+
+        auto& counter = hist.counts[s][bucketOf(us)];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        uint64_t prevMax = hist.maxUs[s].load(std::memory_order_relaxed);
+        while (us > prevMax && !hist.maxUs[s].compare_exchange_weak(prevMax, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    void countAllocations(AllocationCounter counter) {
+        allocationCounterOf.store(counter);
+    }
+
+    uint64_t beginScope() {
+        AllocationCounter counterOf = allocationCounterOf.load(std::memory_order_relaxed);
+        if (!counterOf) return 0;
+        ThreadHistograms& hist = localHistograms();
+        const std::atomic<uint64_t>* counter = hist.allocationCounter.load(std::memory_order_relaxed);
+        if (!counter) {
+            // Allocations before the thread's first scope (including registering it) are not counted
+            counter = counterOf();
+            hist.allocationCounter.store(counter);
+            hist.outsideMark = counter->load(std::memory_order_relaxed);
+        }
+        const uint64_t now = counter->load(std::memory_order_relaxed);
+        if (hist.depth == 0) addRelaxed(hist.allocationsOutside, now - hist.outsideMark);
+        if (hist.depth < MAX_SCOPE_DEPTH) hist.nested[hist.depth] = 0;
+        ++hist.depth;
+        return now;
+    }
+
+    void endScope(Stage stage, int64_t nanoseconds, uint64_t allocationsAtStart) {
+        record(stage, nanoseconds);
+        if (!allocationCounterOf.load(std::memory_order_relaxed)) return;
+        ThreadHistograms& hist = localHistograms();
+        const std::atomic<uint64_t>* counter = hist.allocationCounter.load(std::memory_order_relaxed);
+        if (!counter || hist.depth == 0) return;   // Scope opened before counting started
+
+        const uint64_t now = counter->load(std::memory_order_relaxed);
+        const uint64_t made = now - allocationsAtStart;
+        --hist.depth;
+        const uint64_t nested = hist.depth < MAX_SCOPE_DEPTH ? hist.nested[hist.depth] : 0;
+        addRelaxed(hist.allocations[static_cast<int>(stage)], made - nested);
+        if (hist.depth == 0) {
+            hist.outsideMark = now;
+        } else if (hist.depth - 1 < MAX_SCOPE_DEPTH) {
+            hist.nested[hist.depth - 1] += made;
+        }
+    }
+
+    void allocations(std::vector<ThreadAllocations>& out) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        out.clear();
+        for (auto& thread : reg.threads) {
+            if (out.size() == out.capacity()) break;
+            ThreadAllocations totals;
+            for (int s = 0; s < NUM_STAGES; ++s) {
+                totals.byStage[s] = thread->allocations[s].load(std::memory_order_relaxed);
+                for (int b = 0; b < NUM_BUCKETS; ++b) {
+                    totals.scopes[s] += thread->counts[s][b].load(std::memory_order_relaxed);
+                }
+            }
+            totals.outside = thread->allocationsOutside.load(std::memory_order_relaxed);
+            out.push_back(totals);
+        }
+    }
+
+    void configure(const std::string& outputPath, double flushIntervalSec) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.flushIntervalSec = flushIntervalSec;
+        reg.json = outputPath.size() >= 5 && outputPath.compare(outputPath.size() - 5, 5, ".json") == 0;
+        reg.out.open(outputPath);
+        if (reg.out && !reg.json) {
+            reg.out << "Time,Stage,Count,P50Ms,P95Ms,P99Ms,MaxMs,FPS\n";
+        }
+        reg.lastFlush = std::chrono::steady_clock::now();
+    }
+
+    // Percentile (in ms) from bucket counts
+    static double percentileMs(const std::array<uint64_t, NUM_BUCKETS>& counts, uint64_t total, double p) {
+        if (total == 0) return 0.0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= rank) return bucketValue(b) / 1000.0;
+        }
+        return bucketValue(NUM_BUCKETS - 1) / 1000.0;
+    }
+
+    bool flushIfDue() {
+        Registry& reg = registry();
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - reg.lastFlush).count();
+        if (elapsed < reg.flushIntervalSec) return false;
+
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.lastFlush = now;
+
+        Summary summary;
+        summary.intervalSec = elapsed;
+
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            // Merge all threads and subtract what previous flushes already reported
+            std::array<uint64_t, NUM_BUCKETS> delta{};
+            uint64_t total = 0;
+            uint64_t maxUs = 0;
+            for (auto& thread : reg.threads) {
+                for (int b = 0; b < NUM_BUCKETS; ++b) {
+                    delta[b] += thread->counts[s][b].load(std::memory_order_relaxed);
+                }
+                maxUs = std::max(maxUs, thread->maxUs[s].exchange(0, std::memory_order_relaxed));
+            }
+            for (int b = 0; b < NUM_BUCKETS; ++b) {
+                uint64_t current = delta[b];
+                delta[b] = current - reg.lastCounts[s][b];
+                reg.lastCounts[s][b] = current;
+                total += delta[b];
+            }
+            if (total == 0) continue;
+
+            StageSummary stage;
+            stage.stage = static_cast<Stage>(s);
+            stage.count = total;
+            stage.p50Ms = percentileMs(delta, total, 50);
+            stage.p95Ms = percentileMs(delta, total, 95);
+            stage.p99Ms = percentileMs(delta, total, 99);
+            stage.maxMs = maxUs / 1000.0;
+            summary.stages.push_back(stage);
+
+            if (stage.stage == Stage::Frame) {
+                summary.fps = total / elapsed;
+            }
+        }
+
+        // Write the report: one CSV row or one JSON object per stage
+        double timestamp = std::chrono::duration<double>(now.time_since_epoch()).count();
+        for (const auto& st : summary.stages) {
+            if (!reg.out) break;
+            reg.out << std::fixed << std::setprecision(3);
+            if (reg.json) {
+                reg.out << "{\"time\": " << timestamp << ", \"stage\": \"" << stageName(st.stage)
+                        << "\", \"count\": " << st.count << ", \"p50_ms\": " << st.p50Ms
+                        << ", \"p95_ms\": " << st.p95Ms << ", \"p99_ms\": " << st.p99Ms
+                        << ", \"max_ms\": " << st.maxMs << ", \"fps\": " << summary.fps << "}\n";
+            } else {
+                reg.out << timestamp << "," << stageName(st.stage) << "," << st.count << "," << st.p50Ms
+                        << "," << st.p95Ms << "," << st.p99Ms << "," << st.maxMs << "," << summary.fps << "\n";
+            }
+        }
+        reg.out.flush();
+
+        reg.latest = summary;
+        return true;
+    }
+
+    Summary latest() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        return reg.latest;
+    }
+
+    std::vector<std::string> hudLines() {
+        Summary summary = latest();
+        std::vector<std::string> lines;
+
+        std::ostringstream header;
+        header << std::fixed << std::setprecision(1) << "FPS " << summary.fps << "   p50 / p99 / max (ms)";
+        lines.push_back(header.str());
+
+        for (const auto& st : summary.stages) {
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(2) << std::left << std::setw(11) << stageName(st.stage)
+                 << st.p50Ms << " / " << st.p99Ms << " / " << st.maxMs;
+            lines.push_back(line.str());
+        }
+        return lines;
+    }
+
+}
+
+#endif // ENABLE_PROFILING
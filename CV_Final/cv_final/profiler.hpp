@@ -0,0 +1,117 @@
+/**
+ * profiler.hpp
+ * Author: Niloofar Karimi
+ * Description: Low-overhead per-stage latency instrumentation.
+ *              Scoped timers record into per-thread log-linear (HDR-style) histograms that
+ *              only their owning thread writes, so recording takes no locks. A periodic flush
+ *              merges all threads and reports p50/p95/p99/max per stage, end-to-end frame
+ *              latency and FPS to a CSV or JSON file and to an optional on-screen HUD.
+ *              Given a per-thread allocation counter, scopes also attribute heap allocations
+ *              to their stage (used by the benchmark's steady-state allocation check).
+ *
+ *              Everything compiles out unless ENABLE_PROFILING is defined: the PROFILE_*
+ *              macros expand to nothing and the Profiler namespace is not declared.
+ */
+
+#pragma once
+
+#ifdef ENABLE_PROFILING
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Profiler {
+
+    // Instrumented pipeline stages
+    enum class Stage {
+        Capture, Grayscale, Detect, Align, Preprocess, Forward, Smoothing, Render,
+        Frame,   // End-to-end latency from capture to display
+        Count
+    };
+
+    const char* stageName(Stage stage);
+
+    // Record one duration for a stage on the calling thread
+    void record(Stage stage, int64_t nanoseconds);
+
+    // Scope bookkeeping for ScopedTimer: beginScope() returns the calling thread's allocation
+    // count, endScope() records the duration and attributes the allocations made since
+    uint64_t beginScope();
+    void endScope(Stage stage, int64_t nanoseconds, uint64_t allocationsAtStart);
+
+    // Times the enclosing scope
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage s)
+            : stage(s), allocationsAtStart(beginScope()), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            endScope(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count(), allocationsAtStart);
+        }
+    private:
+        Stage stage;
+        uint64_t allocationsAtStart;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Returns the calling thread's heap allocation count (e.g. bumped by a counting operator
+    // new). The counter must stay valid after its thread exits.
+    using AllocationCounter = const std::atomic<uint64_t>* (*)();
+
+    // Attribute heap allocations to stages: each scope adds the allocations made inside it,
+    // minus those of nested scopes, to its stage; the rest count as outside any scope
+    void countAllocations(AllocationCounter counter);
+
+    // Cumulative heap allocations of one thread since its first scope
+    struct ThreadAllocations {
+        std::array<uint64_t, static_cast<int>(Stage::Count)> byStage{};  // Inside each stage's scopes
+        std::array<uint64_t, static_cast<int>(Stage::Count)> scopes{};   // Scopes recorded per stage
+        uint64_t outside = 0;                                           // Between scopes
+    };
+
+    // Allocations of every thread that has recorded a scope, in a stable order. Fills `out`
+    // up to its capacity, so with enough reserved the snapshot itself does not allocate.
+    void allocations(std::vector<ThreadAllocations>& out);
+
+    // Latency statistics of one stage over a flush interval
+    struct StageSummary {
+        Stage stage;
+        uint64_t count = 0;
+        double p50Ms = 0, p95Ms = 0, p99Ms = 0, maxMs = 0;
+    };
+
+    // Statistics of all stages over a flush interval
+    struct Summary {
+        double intervalSec = 0;
+        double fps = 0;              // Frames completed per second (Stage::Frame records)
+        std::vector<StageSummary> stages;
+    };
+
+    // Set the report file (".json" writes JSON lines, anything else CSV) and flush interval
+    void configure(const std::string& outputPath, double flushIntervalSec);
+
+    // Merge all thread histograms and write a report if the flush interval has elapsed.
+    // Returns true when a new summary was produced.
+    bool flushIfDue();
+
+    // Most recent summary and its HUD text (one line per stage)
+    Summary latest();
+    std::vector<std::string> hudLines();
+
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(stage) Profiler::ScopedTimer PROFILE_CONCAT(profileTimer_, __LINE__)(Profiler::Stage::stage)
+#define PROFILE_RECORD(stage, nanoseconds) Profiler::record(Profiler::Stage::stage, (nanoseconds))
+
+#else
+
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_RECORD(stage, nanoseconds) ((void)0)
+
+#endif // ENABLE_PROFILING
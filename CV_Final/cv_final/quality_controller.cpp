@@ -0,0 +1,100 @@
+/**
+ * quality_controller.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the QualityController: smoothed stage costs, step-down when over
+ *              budget and step-up with hysteresis and restore backoff.
+ */
+
+#include "quality_controller.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Longest restore wait, in multiples of holdFrames
+static const uint64_t MAX_RESTORE_BACKOFF = 32;
+
+const char* qualityLevelName(QualityLevel level) {
+    switch (level) {
+        case QualityLevel::Full: return "full";
+        case QualityLevel::NoTta: return "no-tta";
+        case QualityLevel::NoAlignment: return "no-align";
+        case QualityLevel::ReuseStable: return "reuse";
+        case QualityLevel::LowResDetect: return "low-res";
+        case QualityLevel::DropFrames: return "drop";
+    }
+    return "unknown";
+}
+
+QualityControllerConfig::QualityControllerConfig()
+    : enabled(config::SHED_ENABLED),
+      targetFps(config::SHED_TARGET_FPS),
+      latencySloMs(config::SHED_LATENCY_SLO_MS),
+      restoreHeadroom(config::SHED_RESTORE_HEADROOM),
+      holdFrames(config::SHED_HOLD_FRAMES),
+      smoothing(config::SHED_COST_SMOOTHING) {}
+
+// Constructor: validate the settings and derive the frame budget
+QualityController::QualityController(const QualityControllerConfig& cfg, int classifyWorkers)
+    : config(cfg), workers(std::max(1, classifyWorkers)) {
+    if (config.targetFps <= 0.0 || config.latencySloMs <= 0.0) {
+        throw std::runtime_error("Load shedding needs a positive target FPS and latency SLO");
+    }
+    if (config.smoothing <= 0.0 || config.smoothing > 1.0 || config.holdFrames < 1) {
+        throw std::runtime_error("Load shedding smoothing must be in (0, 1] and hold at least one frame");
+    }
+    budgetMs = 1000.0 / config.targetFps;
+    restoreHold = static_cast<uint64_t>(config.holdFrames);
+}
+
+bool QualityController::observe(const FrameCosts& costs) {
+    if (!config.enabled) return false;
+
+    // Stages overlap, so the slowest one bounds the frame rate
+    const double stage = std::max({costs.detectMs, costs.classifyMs / workers, costs.renderMs});
+    if (!primed) {
+        stageMs = stage;
+        latencyMs = costs.latencyMs;
+        primed = true;
+    } else {
+        stageMs += config.smoothing * (stage - stageMs);
+        latencyMs += config.smoothing * (costs.latencyMs - latencyMs);
+    }
+
+    ++framesSinceChange;
+    const bool over = stageMs > budgetMs || latencyMs > config.latencySloMs;
+    const bool headroom = stageMs < config.restoreHeadroom * budgetMs &&
+                          latencyMs < config.restoreHeadroom * config.latencySloMs;
+    headroomFrames = headroom ? headroomFrames + 1 : 0;
+
+    // Let the averages settle on the current level first
+    const uint64_t hold = static_cast<uint64_t>(config.holdFrames);
+    if (framesSinceChange < hold) return false;
+
+    if (over && level != QualityLevel::DropFrames) {
+        if (lastChangeWasRestore && framesSinceChange < 2 * hold) {
+            // The level we just restored does not fit: wait longer before trying again
+            restoreHold = std::min(restoreHold * 2, MAX_RESTORE_BACKOFF * hold);
+        }
+        level = static_cast<QualityLevel>(static_cast<int>(level) + 1);
+        framesSinceChange = 0;
+        headroomFrames = 0;
+        lastChangeWasRestore = false;
+        return true;
+    }
+
+    if (lastChangeWasRestore && framesSinceChange >= 2 * hold) {
+        // The last restore held
+        restoreHold = hold;
+        lastChangeWasRestore = false;
+    }
+
+    if (level != QualityLevel::Full && headroomFrames >= restoreHold) {
+        level = static_cast<QualityLevel>(static_cast<int>(level) - 1);
+        framesSinceChange = 0;
+        headroomFrames = 0;
+        lastChangeWasRestore = true;
+        return true;
+    }
+    return false;
+}
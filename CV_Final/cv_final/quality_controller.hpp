@@ -0,0 +1,82 @@
+/**
+ * quality_controller.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the QualityController class.
+ *              Keeps the realtime pipeline inside a frame budget (target FPS) and a latency
+ *              SLO by trading quality for time. It measures the cost of every stage online
+ *              (smoothed per frame) and, while the slowest stage or the end-to-end latency is
+ *              over budget, steps down one quality level at a time in a fixed order:
+ *              TTA off, eye alignment off, stable tracks reuse their last classification,
+ *              lower detection resolution, drop every other frame. Once costs stay well under
+ *              budget it steps back up; a restore that immediately overruns again doubles the
+ *              wait before the next attempt, so the level does not oscillate.
+ */
+
+#pragma once
+#include <cstdint>
+
+// Quality levels, from full quality to the most degraded. Each level includes the ones above.
+enum class QualityLevel {
+    Full = 0,          // Everything as configured
+    NoTta,             // Test-time augmentation disabled (on and adaptive)
+    NoAlignment,       // Eye-based rotation estimate skipped (faces classified upright)
+    ReuseStable,       // Stable tracks reuse their previous classification
+    LowResDetect,      // Full-frame detection on a smaller image
+    DropFrames         // Every other captured frame is dropped
+};
+
+const int QUALITY_LEVEL_COUNT = 6;
+
+// Short name of a level ("full", "no-tta", "no-align", "reuse", "low-res", "drop")
+const char* qualityLevelName(QualityLevel level);
+
+// Load-shedding settings (defaults come from config.hpp)
+struct QualityControllerConfig {
+    bool enabled;              // Off: always QualityLevel::Full
+    double targetFps;          // Frame budget is 1000 / targetFps ms for the slowest stage
+    double latencySloMs;       // Capture-to-render latency limit
+    double restoreHeadroom;    // Step up only while costs are below this fraction of the limits
+    int holdFrames;            // Frames to wait after a change (and of headroom before a restore)
+    double smoothing;          // Weight of the newest sample in the cost averages
+
+    QualityControllerConfig();
+};
+
+// Measured costs of one frame
+struct FrameCosts {
+    double detectMs = 0.0;     // Detect stage (one thread)
+    double classifyMs = 0.0;   // Classify stage (one worker)
+    double renderMs = 0.0;     // Render callback
+    double latencyMs = 0.0;    // Capture to render
+};
+
+class QualityController {
+public:
+    // `classifyWorkers` frames are classified in parallel, which divides that stage's cost
+    QualityController(const QualityControllerConfig& config, int classifyWorkers);
+
+    // Add one frame's costs; returns true if the level changed
+    bool observe(const FrameCosts& costs);
+
+    QualityLevel getLevel() const { return level; }
+    bool isEnabled() const { return config.enabled; }
+
+    // Smoothed cost of the slowest stage and smoothed latency (ms)
+    double getStageMs() const { return stageMs; }
+    double getLatencyMs() const { return latencyMs; }
+    double getBudgetMs() const { return budgetMs; }
+
+private:
+    QualityControllerConfig config;
+    int workers;
+    double budgetMs;
+    QualityLevel level = QualityLevel::Full;
+
+    double stageMs = 0.0;            // Smoothed slowest-stage cost per frame
+    double latencyMs = 0.0;          // Smoothed capture-to-render latency
+    bool primed = false;             // Averages hold at least one sample
+    uint64_t framesSinceChange = 0;
+    uint64_t headroomFrames = 0;     // Consecutive frames with restore headroom
+    uint64_t restoreHold;            // Headroom frames required before the next restore
+    bool lastChangeWasRestore = false;
+};
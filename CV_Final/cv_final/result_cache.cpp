@@ -0,0 +1,78 @@
+/**
+ * result_cache.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the per-track ResultCache: crop signatures, lookups with a change
+ *              threshold and a staleness limit, and eviction of tracks that disappeared.
+ */
+
+#include "result_cache.hpp"
+#include "config.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+ResultCacheConfig::ResultCacheConfig()
+    : enabled(config::RESULT_CACHE_ENABLED),
+      maxMeanDiff(config::RESULT_CACHE_MAX_DIFF),
+      maxAge(config::RESULT_CACHE_MAX_AGE) {}
+
+ResultCache::ResultCache(const ResultCacheConfig& cfg) : config(cfg) {}
+
+void ResultCache::computeSignature(const cv::Mat& crop, Signature& signature) {
+    // Area averaging straight into the signature's storage
+    cv::Mat target(SIGNATURE_SIDE, SIGNATURE_SIDE, CV_8UC1, signature.data());
+    cv::resize(crop, target, target.size(), 0, 0, cv::INTER_AREA);
+}
+
+// Mean absolute difference of two signatures, in gray levels
+static double meanDiff(const ResultCache::Signature& a, const ResultCache::Signature& b) {
+    int sum = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        sum += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    }
+    return static_cast<double>(sum) / a.size();
+}
+
+bool ResultCache::lookup(int trackId, uint64_t frameIndex, const Signature* signature, int maxAge,
+                         EmotionPrediction& prediction) {
+    if (trackId < 0) return false;
+    if (signature) lookups.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::lower_bound(entries.begin(), entries.end(), trackId,
+                               [](const Entry& entry, int id) { return entry.trackId < id; });
+    if (it == entries.end() || it->trackId != trackId) return false;
+
+    // Frames may be classified out of order, so the age works in both directions
+    uint64_t age = frameIndex > it->frameIndex ? frameIndex - it->frameIndex : it->frameIndex - frameIndex;
+    if (age > static_cast<uint64_t>(maxAge)) return false;
+    if (signature && meanDiff(*signature, it->signature) > config.maxMeanDiff) return false;
+
+    prediction = it->prediction;
+    if (signature) hits.fetch_add(1);
+    return true;
+}
+
+void ResultCache::store(int trackId, uint64_t frameIndex, const Signature& signature, const EmotionPrediction& prediction) {
+    if (trackId < 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::lower_bound(entries.begin(), entries.end(), trackId,
+                               [](const Entry& entry, int id) { return entry.trackId < id; });
+    if (it == entries.end() || it->trackId != trackId) {
+        entries.insert(it, Entry{trackId, frameIndex, signature, prediction});
+    } else if (frameIndex >= it->frameIndex) {
+        it->frameIndex = frameIndex;
+        it->signature = signature;
+        it->prediction = prediction;
+    }
+
+    // Forget tracks that have not been classified for a while; capacity is kept, so a steady
+    // set of tracks does not allocate
+    newestFrame = std::max(newestFrame, frameIndex);
+    const uint64_t horizon = 4 * static_cast<uint64_t>(std::max(config.maxAge, 1)) + 1;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const Entry& entry) { return entry.frameIndex + horizon < newestFrame; }),
+                  entries.end());
+}
@@ -0,0 +1,75 @@
+/**
+ * result_cache.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the ResultCache class.
+ *              Per-track cache of the last classification, so faces that have not changed
+ *              since they were last classified (people sitting still) skip inference. Each
+ *              entry keeps the prediction, the frame it was computed on and a signature of the
+ *              model-input crop: its 16 x 16 block means. A new crop whose mean absolute
+ *              difference from that signature is within a threshold reuses the prediction,
+ *              up to a maximum age in frames, after which the face is classified again.
+ *              Thread-safe (classification workers share one cache).
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "emotion_classifier.hpp"
+
+// Cache settings (defaults come from config.hpp)
+struct ResultCacheConfig {
+    bool enabled;              // Reuse predictions of unchanged crops
+    double maxMeanDiff;        // Largest mean absolute signature difference (gray levels) for a hit
+    int maxAge;                // Frames a prediction may be reused before the face is reclassified
+
+    ResultCacheConfig();
+};
+
+class ResultCache {
+public:
+    static const int SIGNATURE_SIDE = 16;
+    using Signature = std::array<uint8_t, SIGNATURE_SIDE * SIGNATURE_SIDE>;
+
+    explicit ResultCache(const ResultCacheConfig& config = ResultCacheConfig());
+
+    // Block means of an 8-bit crop (any size), the change signature of a face
+    static void computeSignature(const cv::Mat& crop, Signature& signature);
+
+    // Copy the prediction cached for `trackId` if it was computed at most `maxAge` frames
+    // from `frameIndex` and, with a signature, if the crop is unchanged within the threshold.
+    // Signature lookups are counted in getLookups() / getHits().
+    bool lookup(int trackId, uint64_t frameIndex, const Signature* signature, int maxAge,
+                EmotionPrediction& prediction);
+
+    // Same, with the configured maximum age
+    bool lookup(int trackId, uint64_t frameIndex, const Signature& signature, EmotionPrediction& prediction) {
+        return lookup(trackId, frameIndex, &signature, config.maxAge, prediction);
+    }
+
+    // Record a fresh classification of a track's face (older results never replace newer ones)
+    void store(int trackId, uint64_t frameIndex, const Signature& signature, const EmotionPrediction& prediction);
+
+    bool isEnabled() const { return config.enabled; }
+    uint64_t getLookups() const { return lookups.load(); }
+    uint64_t getHits() const { return hits.load(); }
+
+private:
+    struct Entry {
+        int trackId;
+        uint64_t frameIndex;           // Frame the prediction was computed on
+        Signature signature;           // Crop it was computed from
+        EmotionPrediction prediction;
+    };
+
+    ResultCacheConfig config;
+    std::mutex mutex;
+    std::vector<Entry> entries;        // Sorted by trackId
+    uint64_t newestFrame = 0;          // Drives eviction of tracks no longer classified
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> hits{0};
+};
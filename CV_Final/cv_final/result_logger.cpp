@@ -0,0 +1,201 @@
+/**
+ * result_logger.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the ResultLogger writer thread and its CSV and columnar binary formats.
+ */
+
+#include "result_logger.hpp"
+#include "quality_controller.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const size_t MAX_BATCH = 1024;
+
+LogFormat logFormatForPath(const std::string& path) {
+    const std::string extension = ".bin";
+    bool binary = path.size() >= extension.size() &&
+                  path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    return binary ? LogFormat::Binary : LogFormat::Csv;
+}
+
+// Constructor: open the output and start draining the queue in the background
+ResultLogger::ResultLogger(const ResultLoggerConfig& cfg)
+    : config(cfg), queue(cfg.capacity), startTime(std::chrono::steady_clock::now()) {
+
+    std::ios::openmode mode = std::ios::out | std::ios::trunc;
+    if (config.format == LogFormat::Binary) mode |= std::ios::binary;
+    out.open(config.path, mode);
+    if (!out) {
+        throw std::runtime_error("Failed to open result log: " + config.path);
+    }
+
+    if (config.format == LogFormat::Binary) {
+        // Version 1 + one bit per optional column
+        char magic[] = "EMOLOG01";
+        magic[7] = static_cast<char>('1' + (config.streamColumn ? 1 : 0) + (config.qualityColumn ? 2 : 0));
+        out.write(magic, 8);
+    } else {
+        if (config.streamColumn) out << "Stream,";
+        out << "Frame,Emotion,Confidence,TTA,TrackId,X,Y,Width,Height,TimestampUs";
+        out << (config.qualityColumn ? ",Quality\n" : "\n");
+    }
+
+    writer = std::thread(&ResultLogger::writerLoop, this);
+}
+
+ResultLogger::~ResultLogger() {
+    close();
+}
+
+bool ResultLogger::log(const ResultRecord& record) {
+    ResultRecord copy = record;
+    if (!queue.tryPush(std::move(copy))) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool ResultLogger::log(uint64_t frameIndex, int trackId, const cv::Rect& box, const std::string& label,
+                       float confidence, bool usedTTA, int stream, int quality) {
+    ResultRecord record;
+    record.frameIndex = frameIndex;
+    record.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    record.trackId = trackId;
+    record.x = box.x;
+    record.y = box.y;
+    record.width = box.width;
+    record.height = box.height;
+    record.confidence = confidence;
+    record.usedTTA = usedTTA ? 1 : 0;
+    record.stream = stream;
+    record.quality = static_cast<int8_t>(quality);
+    size_t length = std::min(label.size(), sizeof(record.label) - 1);
+    std::memcpy(record.label, label.data(), length);
+    record.label[length] = '\0';
+    return log(record);
+}
+
+void ResultLogger::close() {
+    if (!writer.joinable()) return;
+    running.store(false, std::memory_order_release);
+    writer.join();
+    out.close();
+}
+
+// Drain the queue in batches; sleep briefly when idle and flush the file at a bounded interval
+void ResultLogger::writerLoop() {
+    std::vector<ResultRecord> batch;
+    batch.reserve(MAX_BATCH);
+    auto lastFlush = std::chrono::steady_clock::now();
+    bool dirty = false;
+
+    for (;;) {
+        // Read the flag before draining so nothing pushed before close() is missed
+        bool stopping = !running.load(std::memory_order_acquire);
+
+        ResultRecord record;
+        while (batch.size() < MAX_BATCH && queue.tryPop(record)) {
+            batch.push_back(record);
+        }
+
+        if (!batch.empty()) {
+            writeBatch(batch);
+            written.fetch_add(batch.size(), std::memory_order_relaxed);
+            dirty = true;
+            bool full = batch.size() == MAX_BATCH;
+            batch.clear();
+            if (full) continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (dirty && (stopping || now - lastFlush >= std::chrono::milliseconds(config.flushIntervalMs))) {
+            out.flush();
+            lastFlush = now;
+            dirty = false;
+        }
+
+        if (stopping) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void ResultLogger::writeBatch(const std::vector<ResultRecord>& batch) {
+    if (config.format == LogFormat::Binary) {
+        writeBinary(batch);
+    } else {
+        writeCsv(batch);
+    }
+
+    // One console write per batch instead of a flushed line per face
+    if (config.echoToConsole) {
+        console.clear();
+        char line[64];
+        for (const auto& r : batch) {
+            std::snprintf(line, sizeof(line), "%s%s (%g)\n", r.usedTTA ? "TTA " : "", r.label, r.confidence);
+            console += line;
+        }
+        std::cout.write(console.data(), static_cast<std::streamsize>(console.size()));
+        std::cout.flush();
+    }
+}
+
+void ResultLogger::writeCsv(const std::vector<ResultRecord>& batch) {
+    text.clear();
+    char line[160];
+    for (const auto& r : batch) {
+        if (config.streamColumn) {
+            std::snprintf(line, sizeof(line), "%d,", r.stream);
+            text += line;
+        }
+        std::snprintf(line, sizeof(line), "%llu,%s,%g,%s,%d,%d,%d,%d,%d,%lld",
+                      static_cast<unsigned long long>(r.frameIndex), r.label, r.confidence,
+                      r.usedTTA ? "Yes" : "No", r.trackId, r.x, r.y, r.width, r.height,
+                      static_cast<long long>(r.timestampUs));
+        text += line;
+        if (config.qualityColumn) {
+            text += ',';
+            text += r.quality >= 0 ? qualityLevelName(static_cast<QualityLevel>(r.quality)) : "";
+        }
+        text += '\n';
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+// Write one field of every record as a contiguous column
+template <typename T, typename Get>
+static void writeColumn(std::ofstream& out, const std::vector<ResultRecord>& batch, Get get) {
+    for (const auto& r : batch) {
+        T value = get(r);
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+void ResultLogger::writeBinary(const std::vector<ResultRecord>& batch) {
+    uint32_t count = static_cast<uint32_t>(batch.size());
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    writeColumn<uint64_t>(out, batch, [](const ResultRecord& r) { return r.frameIndex; });
+    writeColumn<int64_t>(out, batch, [](const ResultRecord& r) { return r.timestampUs; });
+    writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.trackId; });
+    writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.x; });
+    writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.y; });
+    writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.width; });
+    writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.height; });
+    writeColumn<float>(out, batch, [](const ResultRecord& r) { return r.confidence; });
+    writeColumn<uint8_t>(out, batch, [](const ResultRecord& r) { return r.usedTTA; });
+    for (const auto& r : batch) {
+        out.write(r.label, sizeof(r.label));
+    }
+    if (config.streamColumn) {
+        writeColumn<int32_t>(out, batch, [](const ResultRecord& r) { return r.stream; });
+    }
+    if (config.qualityColumn) {
+        writeColumn<int8_t>(out, batch, [](const ResultRecord& r) { return r.quality; });
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * result_logger.hpp
+ * Author: Niloofar Karimi
+ * Description: Asynchronous logger for per-face emotion results.
+ *              The render loop only copies a fixed-size record into a lock-free ring buffer;
+ *              a background thread drains it in batches and writes CSV or a compact columnar
+ *              binary file, optionally echoing to the console once per batch. Memory is bounded
+ *              by the ring capacity: when the writer falls behind, new records are dropped and
+ *              counted instead of blocking the caller.
+ *
+ *              Binary layout: the 8-byte magic "EMOLOG01", then one block per batch holding a
+ *              uint32 record count followed by each field as a contiguous column in the order
+ *              of ResultRecord (frameIndex, timestampUs, trackId, x, y, width, height,
+ *              confidence, usedTTA, label). All values are in host byte order. Optional
+ *              columns extend both formats (see ResultLoggerConfig).
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+// One classified face. Trivially copyable so logging never allocates.
+struct ResultRecord {
+    uint64_t frameIndex = 0;
+    int64_t timestampUs = 0;     // Time since the logger was created
+    int32_t trackId = -1;
+    int32_t x = 0, y = 0, width = 0, height = 0;
+    float confidence = 0.0f;
+    uint8_t usedTTA = 0;
+    char label[16] = {};         // Null-terminated, truncated if longer
+    int32_t stream = -1;         // Source index in multi-stream runs (-1 = single source)
+    int8_t quality = -1;         // QualityLevel the frame was processed at (-1 = not recorded)
+};
+
+enum class LogFormat { Csv, Binary };
+
+// Binary for paths ending in ".bin", CSV otherwise
+LogFormat logFormatForPath(const std::string& path);
+
+struct ResultLoggerConfig {
+    std::string path = "results.csv";
+    LogFormat format = LogFormat::Csv;
+    size_t capacity = 4096;          // Ring buffer size in records (rounded up to a power of two)
+    bool echoToConsole = false;      // Also print "label (confidence)" lines, batched
+    int flushIntervalMs = 200;       // Longest time a written record may sit in the file buffer
+    // Optional columns. Stream: a leading CSV Stream column, or an int32 binary column after
+    // the labels. Quality: a trailing CSV Quality column with the level name, or an int8 binary
+    // column after those. The binary magic ends in 1 + 1 (stream) + 2 (quality): EMOLOG01..04.
+    bool streamColumn = false;       // Write each record's stream index (multi-stream runs)
+    bool qualityColumn = false;      // Write each record's load-shedding level
+};
+
+class ResultLogger {
+public:
+    // Constructor: open the output file and start the writer thread
+    explicit ResultLogger(const ResultLoggerConfig& config);
+    ~ResultLogger();
+
+    ResultLogger(const ResultLogger&) = delete;
+    ResultLogger& operator=(const ResultLogger&) = delete;
+
+    // Queue one record. Never blocks; returns false if the buffer was full and it was dropped.
+    // Safe to call from several threads.
+    bool log(const ResultRecord& record);
+
+    // Convenience overload filling a record from a face result
+    bool log(uint64_t frameIndex, int trackId, const cv::Rect& box, const std::string& label,
+             float confidence, bool usedTTA, int stream = -1, int quality = -1);
+
+    // Write everything still queued, then stop the writer thread and close the file
+    void close();
+
+    uint64_t getWritten() const { return written.load(std::memory_order_relaxed); }
+    uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    void writeBatch(const std::vector<ResultRecord>& batch);
+    void writeCsv(const std::vector<ResultRecord>& batch);
+    void writeBinary(const std::vector<ResultRecord>& batch);
+
+    ResultLoggerConfig config;
+    BoundedQueue<ResultRecord> queue;
+    std::ofstream out;
+    std::string text;                    // Reused CSV / console formatting buffer
+    std::string console;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::thread writer;
+};
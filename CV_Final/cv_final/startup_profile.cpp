@@ -0,0 +1,48 @@
+/**
+ * startup_profile.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the StartupProfile class: thread-safe phase records and the
+ *              startup breakdown report.
+ */
+
+#include "startup_profile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+StartupProfile::StartupProfile() : start(std::chrono::steady_clock::now()) {}
+
+void StartupProfile::record(const std::string& phase, double startMs, double endMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    phases.push_back(Phase{phase, startMs, endMs});
+}
+
+double StartupProfile::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void StartupProfile::print(std::ostream& out) const {
+    std::vector<Phase> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = phases;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b) { return a.startMs < b.startMs; });
+
+    size_t width = 5;
+    double endMs = 0.0;
+    for (const auto& phase : sorted) {
+        width = std::max(width, phase.name.size());
+        endMs = std::max(endMs, phase.endMs);
+    }
+
+    out << "Startup (ms since launch; overlapping phases ran in parallel):\n";
+    char line[160];
+    for (const auto& phase : sorted) {
+        std::snprintf(line, sizeof(line), "  %-*s %8.1f -> %8.1f  %8.1f ms\n", static_cast<int>(width),
+                      phase.name.c_str(), phase.startMs, phase.endMs, phase.endMs - phase.startMs);
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "  %-*s %8s    %8s  %8.1f ms\n", static_cast<int>(width), "total", "", "", endMs);
+    out << line;
+}
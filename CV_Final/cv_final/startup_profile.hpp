@@ -0,0 +1,72 @@
+/**
+ * startup_profile.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the StartupProfile class.
+ *              Records when each startup phase (opening the source, loading the models and
+ *              cascades, warm-up, the first frame) started and ended, from any thread, and
+ *              prints a breakdown. Phases that overlap in the report ran in parallel.
+ */
+
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class StartupProfile {
+public:
+    // Times are measured from construction
+    StartupProfile();
+
+    // Records a phase from construction of the timer until it goes out of scope
+    class PhaseTimer {
+    public:
+        PhaseTimer(StartupProfile& profile, std::string phase)
+            : profile(profile), phase(std::move(phase)), startMs(profile.elapsedMs()) {}
+        ~PhaseTimer() { profile.record(phase, startMs, profile.elapsedMs()); }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        StartupProfile& profile;
+        std::string phase;
+        double startMs;
+    };
+
+    // Run `step`, record it as `phase` and return its result
+    template <typename Step>
+    auto measure(const std::string& phase, Step&& step) -> decltype(step()) {
+        PhaseTimer timer(*this, phase);
+        return step();
+    }
+
+    // Add a phase that ran from `startMs` to `endMs` (thread-safe)
+    void record(const std::string& phase, double startMs, double endMs);
+
+    // Milliseconds since construction
+    double elapsedMs() const;
+
+    // Phases in order of their start, with start and end times and durations
+    void print(std::ostream& out) const;
+
+private:
+    struct Phase {
+        std::string name;
+        double startMs;
+        double endMs;
+    };
+
+    std::chrono::steady_clock::time_point start;
+    mutable std::mutex mutex;
+    std::vector<Phase> phases;
+};
+
+// Run a startup step, recording it in `profile` when one is given
+template <typename Step>
+auto measureStartup(StartupProfile* profile, const std::string& phase, Step&& step) -> decltype(step()) {
+    if (!profile) return step();
+    return profile->measure(phase, std::forward<Step>(step));
+}
@@ -0,0 +1,342 @@
+/**
+ * stream_server.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the multi-stream server: the shared worker pool, the
+ *              earliest-deadline-first stream scheduler and per-stream frame processing.
+ */
+
+#include "stream_server.hpp"
+#include "assets.hpp"
+#include "config.hpp"
+#include "face_aligner.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_source.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+StreamServerConfig::StreamServerConfig()
+    : modelPath(Assets::modelPath()),
+      faceCascadePath(Assets::faceCascadePath()),
+      eyeCascadePath(Assets::eyeCascadePath()),
+      workers(config::STREAM_WORKERS),
+      maxBatchSize(config::MAX_BATCH_SIZE),
+      batchInference(config::STREAM_BATCH_INFERENCE),
+      batchDelayMs(config::BATCHER_MAX_DELAY_MS),
+      useTracking(config::USE_FACE_TRACKING),
+      useTTA(false),
+      defaultFps(config::STREAM_DEFAULT_FPS),
+      readAhead(static_cast<size_t>(config::STREAM_READ_AHEAD)),
+      realtimeFiles(false) {}
+
+// Detector settings for pool workers: each detector serves many streams, so a size history
+// would mix unrelated sources, and tiles would only compete with the other workers for cores
+static FaceDetectorConfig poolDetectorConfig() {
+    FaceDetectorConfig detectorConfig;
+    detectorConfig.adaptiveSizes = false;
+    detectorConfig.tileRows = detectorConfig.tileCols = 1;
+    return detectorConfig;
+}
+
+// Per-worker state: models and cascades are not thread-safe, so every worker owns its own
+struct StreamServer::Worker {
+    std::unique_ptr<EmotionClassifier> classifier;   // Null when a shared batcher is used
+    FaceDetector detector;
+    FaceAligner aligner;
+    std::thread thread;
+
+    Worker(const StreamServerConfig& config)
+        : detector(config.faceCascadePath, poolDetectorConfig()),
+          aligner(config.eyeCascadePath) {
+        if (!config.batchInference) {
+            // The pool already keeps every core busy; cv::setNumThreads is process-wide
+            InferenceEngineConfig engine = config.engine;
+            if (engine.numThreads == 0) engine.numThreads = 1;
+            classifier = std::make_unique<EmotionClassifier>(config.modelPath, engine);
+            classifier->setMaxBatchSize(config.maxBatchSize);
+            classifier->setQuiet(true);
+        }
+    }
+};
+
+// Per-stream state. The reader, tracker and angle cache are only touched by the worker that
+// currently holds the stream; the scheduling fields are guarded by StreamServer::mutex.
+struct StreamServer::Stream {
+    int index;
+    FrameReader reader;
+    FaceTracker tracker;
+    FaceAligner::AngleCache angleCache;
+    FrameResult result;                  // Reused for every frame of this stream (frame size is fixed)
+    Clock::duration interval;            // Time between frame deadlines
+
+    Clock::time_point due;               // Deadline of the next frame
+    Clock::time_point finishTime;
+    bool busy = false;
+    double latencySumMs = 0.0;
+    uint64_t discardedSeen = 0;          // Camera frames already counted as skipped
+    StreamStats stats;
+
+    Stream(int idx, const StreamSpec& spec, const FrameSourceConfig& source, FaceDetector& detector,
+           double fps)
+        : index(idx), reader(source), tracker(detector),
+          interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps))) {
+        stats.input = spec.input;
+        stats.targetFps = fps;
+    }
+};
+
+// Constructor: size the pool, load one model set per worker, then open every source
+StreamServer::StreamServer(const StreamServerConfig& cfg, const std::vector<StreamSpec>& specs)
+    : config(cfg) {
+    if (specs.empty()) {
+        throw std::runtime_error("StreamServer needs at least one stream");
+    }
+
+    // A stream is never processed by two workers at once, so extra workers would sit idle
+    int poolSize = config.workers > 0 ? config.workers
+                                      : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    poolSize = std::min(poolSize, static_cast<int>(specs.size()));
+    if (config.batchInference) {
+        InferenceBatcherConfig batcherConfig;
+        batcherConfig.maxBatchSize = config.maxBatchSize;
+        batcherConfig.maxDelayMs = config.batchDelayMs;
+        batcher = std::make_unique<InferenceBatcher>(config.modelPath, config.engine, batcherConfig);
+    }
+    for (int i = 0; i < poolSize; ++i) {
+        workers.push_back(std::make_unique<Worker>(config));
+    }
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        FrameSourceConfig source;
+        source.input = specs[i].input;
+        source.readAhead = config.readAhead;
+        source.sequenceFps = config::DEFAULT_SEQUENCE_FPS;
+        source.luma = true;   // Streams are never displayed, so color is never needed
+        // Cameras are grabbed continuously and only their newest frame is processed when the
+        // stream's deadline comes up, so frames never queue up in the driver
+        source.latestOnly = true;
+        double fps = specs[i].targetFps > 0.0 ? specs[i].targetFps : config.defaultFps;
+        if (fps <= 0.0) {
+            throw std::runtime_error("Invalid target FPS for stream: " + specs[i].input);
+        }
+        streams.push_back(std::make_unique<Stream>(static_cast<int>(i), specs[i], source,
+                                                   workers.front()->detector, fps));
+    }
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+void StreamServer::start(ResultSink resultSink) {
+    sink = std::move(resultSink);
+    startTime = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& stream : streams) stream->due = startTime;
+        activeStreams = static_cast<int>(streams.size());
+        running = true;
+    }
+
+    // A failing worker stops the whole server; the error is rethrown from waitFor()
+    for (auto& worker : workers) {
+        Worker* w = worker.get();
+        worker->thread = std::thread([this, w]() {
+            try {
+                workerLoop(*w);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+                running = false;
+                wake.notify_all();
+            }
+        });
+    }
+}
+
+bool StreamServer::waitFor(std::chrono::milliseconds timeout) {
+    bool done;
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait_for(lock, timeout, [this]() { return activeStreams == 0 || !running; });
+        done = activeStreams == 0 || !running;
+        failure = error;
+    }
+    if (failure) {
+        stop();
+        std::rethrow_exception(failure);
+    }
+    return done;
+}
+
+void StreamServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+InferenceBatcherStats StreamServer::getBatcherStats() const {
+    return batcher ? batcher->getStats() : InferenceBatcherStats();
+}
+
+std::vector<StreamStats> StreamServer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    std::vector<StreamStats> result;
+    result.reserve(streams.size());
+    for (const auto& stream : streams) {
+        StreamStats stats = stream->stats;
+        Clock::time_point end = stats.finished ? stream->finishTime : now;
+        double elapsed = std::chrono::duration<double>(end - startTime).count();
+        stats.achievedFps = elapsed > 0.0 ? stats.processed / elapsed : 0.0;
+        stats.meanLatencyMs = stats.processed > 0 ? stream->latencySumMs / stats.processed : 0.0;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+// Worker: repeatedly take the most urgent free stream and process one frame of it
+void StreamServer::workerLoop(Worker& worker) {
+    while (Stream* stream = acquireStream()) {
+        Clock::time_point begin = Clock::now();
+        size_t faces = 0;
+        uint64_t skipped = 0;
+        bool hasMore = processFrame(worker, *stream, faces, skipped);
+        double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        releaseStream(*stream, hasMore, faces, skipped, latencyMs);
+    }
+}
+
+StreamServer::Stream* StreamServer::acquireStream() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running && activeStreams > 0) {
+        // Earliest deadline among streams no other worker is holding
+        Stream* next = nullptr;
+        for (auto& stream : streams) {
+            if (stream->busy || stream->stats.finished) continue;
+            if (!next || stream->due < next->due) next = stream.get();
+        }
+
+        if (!next) {
+            wake.wait(lock);   // Every remaining stream is being processed
+        } else if (next->due <= Clock::now()) {
+            next->busy = true;
+            return next;
+        } else {
+            wake.wait_until(lock, next->due);
+        }
+    }
+    return nullptr;
+}
+
+void StreamServer::releaseStream(Stream& stream, bool hasMore, size_t faces, uint64_t skipped, double latencyMs) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stream.busy = false;
+        stream.stats.skipped += skipped;
+
+        if (hasMore) {
+            ++stream.stats.processed;
+            stream.stats.faces += faces;
+            stream.latencySumMs += latencyMs;
+
+            // Next deadline one interval later. A stream more than an interval behind restarts
+            // its schedule from now rather than bursting to catch up, which would starve others.
+            Clock::time_point now = Clock::now();
+            stream.due += stream.interval;
+            if (stream.due + stream.interval < now) {
+                ++stream.stats.late;
+                stream.due = now;
+            }
+        } else {
+            stream.stats.finished = true;
+            stream.finishTime = Clock::now();
+            --activeStreams;
+        }
+    }
+    wake.notify_all();
+}
+
+bool StreamServer::processFrame(Worker& worker, Stream& stream, size_t& faces, uint64_t& skipped) {
+    FrameResult& result = stream.result;
+    result.reset();
+
+    // Files standing in for cameras: drop the frames a camera would have delivered meanwhile
+    if (config.realtimeFiles && !stream.reader.isLive()) {
+        double elapsed = std::chrono::duration<double>(Clock::now() - startTime).count();
+        uint64_t current = static_cast<uint64_t>(elapsed * stream.reader.getFps());
+        while (stream.reader.getFramesRead() < current) {
+            if (!stream.reader.read(result.frame)) return false;
+            ++skipped;
+        }
+    }
+
+    {
+        PROFILE_SCOPE(Capture);
+        if (!stream.reader.read(result.frame)) return false;
+    }
+    if (stream.reader.isLive()) {
+        // Camera frames replaced in the reader's slot since the last frame was taken
+        const uint64_t discarded = stream.reader.getFramesDiscarded();
+        skipped += discarded - stream.discardedSeen;
+        stream.discardedSeen = discarded;
+    }
+    result.index = stream.reader.getFramesRead() - 1;
+    result.captureTime = Clock::now();
+
+    {
+        PROFILE_SCOPE(Grayscale);
+        if (result.frame.type() == CV_8UC1) {
+            result.gray = result.frame;
+        } else {
+            result.gray = result.arena.mat(result.frame.size(), CV_8UC1);
+            Utils::toGrayscale(result.frame, result.gray);
+        }
+    }
+    {
+        PROFILE_SCOPE(Detect);
+        if (config.useTracking) {
+            stream.tracker.setDetector(worker.detector);
+            for (const auto& track : stream.tracker.update(result.gray)) {
+                result.faces.push_back(track.box);
+                result.trackIds.push_back(track.id);
+            }
+        } else {
+            const std::vector<cv::Rect> detections = worker.detector.detect(result.gray);
+            result.faces.assign(detections.begin(), detections.end());
+            result.trackIds.assign(result.faces.size(), -1);
+        }
+    }
+
+    const cv::Size inputSize(config::INPUT_WIDTH, config::INPUT_HEIGHT);
+    result.alignedFaces.resize(result.faces.size());
+    {
+        PROFILE_SCOPE(Align);
+        worker.aligner.estimateAngles(result.gray, result.faces, result.trackIds, result.angles, stream.angleCache);
+        for (size_t i = 0; i < result.faces.size(); ++i) {
+            result.alignedFaces[i] = result.arena.mat(inputSize, CV_8UC1);
+            alignCrop(result.gray, result.faces[i], result.angles[i], inputSize, result.alignedFaces[i]);
+        }
+    }
+
+    result.usedTTA = config.useTTA;
+    if (batcher) {
+        result.predictions = batcher->classifyBatch(result.alignedFaces, result.usedTTA);
+    } else {
+        worker.classifier->classifyBatch(result.alignedFaces, result.usedTTA, result.predictions);
+    }
+    faces = result.faces.size();
+
+    if (sink) sink(stream.index, result);
+    return true;
+}
@@ -0,0 +1,136 @@
+/**
+ * stream_server.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the StreamServer class.
+ *              Processes many sources (cameras, video files, image sequences) in one process
+ *              with a shared pool of workers sized to the machine (never more than the number
+ *              of streams). Each worker owns one EmotionClassifier, FaceDetector and FaceAligner;
+ *              a stream only keeps its reader, tracker and cached face angles, and is handed
+ *              to whichever worker is free when its next frame is due.
+ *
+ *              Scheduling is earliest-deadline-first over per-stream frame deadlines (one
+ *              every 1 / targetFps seconds), so streams interleave fairly and, when the pool is
+ *              overloaded, every stream slows down proportionally instead of one starving the
+ *              others. A stream is processed by at most one worker at a time, so its frames
+ *              stay in order and its tracker state needs no locking.
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "inference_batcher.hpp"
+#include "inference_engine.hpp"
+#include "pipeline.hpp"
+
+// A source handled by the server
+struct StreamSpec {
+    std::string input;          // Camera index, video file, image sequence pattern or directory
+    double targetFps = 0.0;     // Frames processed per second (0 = StreamServerConfig::defaultFps)
+};
+
+// Settings shared by all streams (defaults come from config.hpp)
+struct StreamServerConfig {
+    std::string modelPath;
+    std::string faceCascadePath;
+    std::string eyeCascadePath;
+    InferenceEngineConfig engine;  // Inference engine (per-worker classifiers default to one thread)
+    int workers;                // Pool size (0 = one per hardware thread)
+    int maxBatchSize;           // Max faces per forward pass
+    bool batchInference;        // Batch all workers' faces through one shared InferenceBatcher
+    double batchDelayMs;        // Batcher deadline (see InferenceBatcherConfig::maxDelayMs)
+    bool useTracking;           // Track faces between keyframes (one tracker per stream)
+    bool useTTA;                // Apply test-time augmentation to every face
+    double defaultFps;          // Target frame rate of streams that do not set one
+    size_t readAhead;           // Decoded frames buffered per file source
+    bool realtimeFiles;         // Treat file sources like cameras: skip frames to keep up with
+                                // their own frame rate instead of processing every frame
+
+    StreamServerConfig();
+};
+
+// Per-stream counters
+struct StreamStats {
+    std::string input;
+    double targetFps = 0.0;
+    uint64_t processed = 0;     // Frames classified
+    uint64_t skipped = 0;       // Frames skipped to keep up: camera frames superseded by a newer
+                                // one, and file frames with realtimeFiles
+    uint64_t late = 0;          // Times the stream fell more than one interval behind schedule
+    uint64_t faces = 0;         // Faces classified
+    double achievedFps = 0.0;   // processed / time since start
+    double meanLatencyMs = 0.0; // Mean read-to-result time per frame
+    bool finished = false;      // Source exhausted or failed
+};
+
+class StreamServer {
+public:
+    // Receives every processed frame. Called on worker threads: concurrently for different
+    // streams, but in frame order and never concurrently for the same stream.
+    using ResultSink = std::function<void(int stream, const FrameResult& result)>;
+
+    // Constructor: opens every source (stream i = streams[i]) and loads the worker pool, one
+    // model, detector and eye cascade per worker
+    StreamServer(const StreamServerConfig& config, const std::vector<StreamSpec>& streams);
+    ~StreamServer();
+
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    // Start the workers (non-blocking; call once)
+    void start(ResultSink sink);
+
+    // Wait up to `timeout` for every stream to finish; returns true once all have. Rethrows
+    // the first exception thrown by a worker.
+    bool waitFor(std::chrono::milliseconds timeout);
+
+    // Stop processing and join the workers (safe to call more than once)
+    void stop();
+
+    // Snapshot of every stream's counters (safe to call while running)
+    std::vector<StreamStats> getStats() const;
+
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+
+    // Statistics of the shared batcher (empty without batchInference)
+    InferenceBatcherStats getBatcherStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Worker;
+    struct Stream;
+
+    void workerLoop(Worker& worker);
+
+    // Block until a stream is due and free, claim it and return it (nullptr once stopping
+    // or every stream has finished)
+    Stream* acquireStream();
+
+    // Give a stream back, add the frame to its counters and schedule its next deadline
+    void releaseStream(Stream& stream, bool hasMore, size_t faces, uint64_t skipped, double latencyMs);
+
+    // Read, detect, align and classify one frame of `stream`; false when the source has ended
+    bool processFrame(Worker& worker, Stream& stream, size_t& faces, uint64_t& skipped);
+
+    StreamServerConfig config;
+    std::unique_ptr<InferenceBatcher> batcher;   // Shared by all workers with batchInference
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<Stream>> streams;
+    ResultSink sink;
+    Clock::time_point startTime;
+
+    mutable std::mutex mutex;         // Guards scheduling state and stream stats
+    std::condition_variable wake;     // Signalled when a stream is released or finishes
+    bool running = false;
+    int activeStreams = 0;
+
+    std::exception_ptr error;         // First exception thrown by a worker
+};
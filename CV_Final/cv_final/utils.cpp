@@ -7,6 +7,7 @@
 
 #include "utils.hpp"
 #include <opencv2/imgproc.hpp>
+#include <cmath>
 
 namespace Utils {
 
@@ -17,4 +18,18 @@ namespace Utils {
         return gray;
     }
 
+    // Convert into a caller-provided buffer (e.g. one drawn from a FrameArena)
+    void toGrayscale(const cv::Mat& input, cv::Mat& out) {
+        cv::cvtColor(input, out, cv::COLOR_BGR2GRAY);
+    }
+
+    // Rotation about `center` followed by scaling, as in cv::getRotationMatrix2D
+    cv::Matx23d rotationMatrix(const cv::Point2d& center, double angle, double scale) {
+        double radians = angle * CV_PI / 180.0;
+        double alpha = std::cos(radians) * scale;
+        double beta = std::sin(radians) * scale;
+        return cv::Matx23d(alpha, beta, (1.0 - alpha) * center.x - beta * center.y,
+                           -beta, alpha, beta * center.x + (1.0 - alpha) * center.y);
+    }
+
 }
@@ -12,4 +12,11 @@
 namespace Utils {
     // Convert a BGR image to grayscale (used before face detection/classification)
     cv::Mat toGrayscale(const cv::Mat& input);
+
+    // Same, writing into `out` (no allocation when `out` already has the input's size and CV_8UC1)
+    void toGrayscale(const cv::Mat& input, cv::Mat& out);
+
+    // Same matrix as cv::getRotationMatrix2D (angle in degrees, counter-clockwise), built on
+    // the stack instead of in a heap-allocated cv::Mat
+    cv::Matx23d rotationMatrix(const cv::Point2d& center, double angle, double scale);
 }
@@ -10,8 +10,8 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
 
 namespace VideoOverlay {
 
@@ -20,18 +20,20 @@ namespace VideoOverlay {
                         const std::vector<cv::Rect>& faces,
                         const std::vector<std::string>& labels,
                         const std::vector<float>& confidences) {
+        // Reused between calls so labelling a frame does not allocate
+        thread_local std::string labelText;
+
         for (size_t i = 0; i < faces.size(); ++i) {
             const cv::Rect& rect = faces[i];
             const std::string& label = labels[i];
 
             // Format label with confidence as percentage (if available)
-            std::ostringstream oss;
+            labelText.assign(label);
             if (i < confidences.size()) {
-                oss << label << " (" << std::fixed << std::setprecision(2) << confidences[i] * 100 << "%)";
-            } else {
-                oss << label;
+                char percent[32];
+                std::snprintf(percent, sizeof(percent), " (%.2f%%)", confidences[i] * 100);
+                labelText.append(percent);
             }
-            std::string labelText = oss.str();
 
             // Draw bounding box around the face in green
             cv::rectangle(frame, rect, cv::Scalar(0, 255, 0), 2);
@@ -50,4 +52,25 @@ namespace VideoOverlay {
         }
     }
 
+    // Draw status lines in the top-left corner on a filled dark background
+    void drawStats(cv::Mat& frame, const std::vector<std::string>& lines) {
+        if (lines.empty()) return;
+
+        const double fontScale = 0.45;
+        const int lineHeight = 16;
+        int width = 0;
+        for (const auto& line : lines) {
+            int baseline = 0;
+            width = std::max(width, cv::getTextSize(line, cv::FONT_HERSHEY_SIMPLEX, fontScale, 1, &baseline).width);
+        }
+
+        cv::Rect panel(0, 0, width + 12, static_cast<int>(lines.size()) * lineHeight + 8);
+        cv::rectangle(frame, panel & cv::Rect(0, 0, frame.cols, frame.rows), cv::Scalar(0, 0, 0), cv::FILLED);
+
+        for (size_t i = 0; i < lines.size(); ++i) {
+            cv::putText(frame, lines[i], cv::Point(6, 4 + lineHeight * static_cast<int>(i + 1) - 4),
+                        cv::FONT_HERSHEY_SIMPLEX, fontScale, cv::Scalar(255, 255, 255), 1);
+        }
+    }
+
 }
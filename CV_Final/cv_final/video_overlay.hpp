@@ -2,7 +2,8 @@
  * video_overlay.hpp
  * Author: Niloofar Karimi
  * Description: Header file for drawing overlays on the video stream.
- *              Provides functionality to annotate detected faces with emotion labels and confidence.
+ *              Provides functionality to annotate detected faces with emotion labels and confidence,
+ *              and to show status text such as performance statistics.
  */
 
 #pragma once
@@ -17,4 +18,7 @@ namespace VideoOverlay {
                         const std::vector<cv::Rect>& faces,
                         const std::vector<std::string>& labels,
                         const std::vector<float>& confidences);
+
+    // Draws lines of status text (e.g. profiler HUD) on a dark panel in the top-left corner
+    void drawStats(cv::Mat& frame, const std::vector<std::string>& lines);
 }
@@ -0,0 +1,129 @@
+/**
+ * work_stealing_pool.cpp
+ * Author: Niloofar Karimi
+ * Description: Implements the WorkStealingPool class.
+ */
+
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// Index of the pool worker running on the current thread (-1 outside the pool)
+static thread_local int currentWorkerId = -1;
+static thread_local const WorkStealingPool* currentPool = nullptr;
+
+// Constructor: create one deque and one thread per worker
+WorkStealingPool::WorkStealingPool(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    for (int i = 0; i < numThreads; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+// Destructor: let workers finish outstanding tasks, then join them
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::push(int workerId, Task task) {
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[workerId]->mutex);
+        queues[workerId]->tasks.push_back(std::move(task));
+    }
+    // Take the state lock so a worker about to sleep cannot miss the notification
+    { std::lock_guard<std::mutex> lock(stateMutex); }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::submit(Task task) {
+    int workerId = static_cast<int>(nextQueue.fetch_add(1) % queues.size());
+    push(workerId, std::move(task));
+}
+
+void WorkStealingPool::submitLocal(Task task) {
+    if (currentPool != this || currentWorkerId < 0) {
+        submit(std::move(task));
+        return;
+    }
+    push(currentWorkerId, std::move(task));
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this]() { return pending.load() == 0; });
+
+    if (firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Owner takes the newest task from its own deque
+bool WorkStealingPool::popLocal(int workerId, Task& task) {
+    WorkerQueue& queue = *queues[workerId];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+// Thief takes the oldest task from the first non-empty deque after its own
+bool WorkStealingPool::steal(int thiefId, Task& task) {
+    const int numQueues = size();
+    for (int offset = 1; offset < numQueues; ++offset) {
+        WorkerQueue& victim = *queues[(thiefId + offset) % numQueues];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int workerId) {
+    currentWorkerId = workerId;
+    currentPool = this;
+
+    while (true) {
+        Task task;
+        if (popLocal(workerId, task) || steal(workerId, task)) {
+            try {
+                task(workerId);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (!firstError) firstError = std::current_exception();
+            }
+
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to run anywhere: sleep until new work arrives or the pool shuts down.
+        // The timeout guards against a task pushed between the steal attempt and the wait.
+        std::unique_lock<std::mutex> lock(stateMutex);
+        if (stopping && pending.load() == 0) break;
+        workAvailable.wait_for(lock, std::chrono::milliseconds(5));
+    }
+}
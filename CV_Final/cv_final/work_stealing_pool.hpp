@@ -0,0 +1,67 @@
+/**
+ * work_stealing_pool.hpp
+ * Author: Niloofar Karimi
+ * Description: Header file for the WorkStealingPool class.
+ *              A fixed-size thread pool where every worker owns a task deque. Workers run
+ *              their own tasks newest-first and steal the oldest tasks from other workers
+ *              when they run out, which keeps follow-up work local and load balanced.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // A task receives the index of the worker running it (0 .. size()-1), so callers can
+    // keep per-worker state such as a model instance
+    using Task = std::function<void(int workerId)>;
+
+    // Constructor: start numThreads workers (0 = std::thread::hardware_concurrency())
+    explicit WorkStealingPool(int numThreads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Submit a task from outside the pool (distributed round-robin across workers)
+    void submit(Task task);
+
+    // Submit a follow-up task from inside a running task; it is queued on the current
+    // worker's own deque and runs next (falls back to submit() when called from outside)
+    void submitLocal(Task task);
+
+    // Block until every submitted task has finished. Rethrows the first task exception.
+    void wait();
+
+    int size() const { return static_cast<int>(queues.size()); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(int workerId);
+    bool popLocal(int workerId, Task& task);
+    bool steal(int thiefId, Task& task);
+    void push(int workerId, Task task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;   // Signalled when tasks are pushed or on shutdown
+    std::condition_variable allDone;         // Signalled when the pending count reaches zero
+    std::atomic<size_t> pending{0};          // Tasks submitted but not yet finished
+    std::atomic<size_t> nextQueue{0};        // Round-robin cursor for submit()
+    bool stopping = false;
+    std::exception_ptr firstError;
+};